@@ -0,0 +1,222 @@
+// Times the lexer, parser, tree walker (with and without the loop JIT) and
+// bytecode VM separately on one workload, then the VM again on the program after the constant folder,
+// the SSA passes and the type pass, and prints the results as a single JSON object per line.
+//
+// Usage: bench <name> <source file> <loop iterations> [runs]
+//
+// Each phase is repeated `runs` times and the fastest run is reported, which
+// is the most stable figure for comparing releases. Program output is sent
+// to /dev/null while phases run.
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "lexer.h"
+#include "parser.h"
+#include "interpreter.h"
+#include "compiler.h"
+#include "vm.h"
+#include "resolver.h"
+#include "arena.h"
+#include "optimizer.h"
+#include "ir.h"
+#include "jit.h"
+#include "types.h"
+#include "io.h"
+#include "context.h"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Bytes the tree's columns and side tables hold, ignoring spare capacity
+static size_t ast_bytes(Ast *ast) {
+    size_t per_node = 2 * sizeof(uint8_t) + 2 * sizeof(NodeId) + sizeof(uint32_t) + 2 * sizeof(int32_t);
+    return ast->count * per_node + ast->number_count * sizeof(double) +
+           ast->name_count * sizeof(char*) + ast->child_count * sizeof(NodeId);
+}
+
+static size_t lex_all(const char *source, size_t length) {
+    Arena *arena = arena_create();
+    Lexer *lexer = init_lexer(source, length, arena);
+    size_t tokens = 0;
+    while (get_next_token(lexer).type != TOKEN_EOF) {
+        tokens++;
+    }
+    free_lexer(lexer);
+    arena_destroy(arena);
+    return tokens;
+}
+
+static int saved_stdout = -1;
+
+static void silence_stdout(void) {
+    io_flush(io_standard());
+    saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+}
+
+static void restore_stdout(void) {
+    io_flush(io_standard()); // Program output is buffered apart from stdio
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4 || argc > 5) {
+        fprintf(stderr, "Usage: %s <name> <source file> <loop iterations> [runs]\n", argv[0]);
+        return 1;
+    }
+    const char *name = argv[1];
+    const char *path = argv[2];
+    double iterations = atof(argv[3]);
+    int runs = argc == 5 ? atoi(argv[4]) : 5;
+    if (runs < 1) runs = 1;
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        perror("Failed to open workload");
+        return 1;
+    }
+    size_t length = (size_t)st.st_size;
+    const char *source = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (source == MAP_FAILED) {
+        perror("Failed to map workload");
+        return 1;
+    }
+
+    double best_lex = 1e30, best_parse = 1e30, best_interpret = 1e30, best_vm = 1e30, best_ssa_vm = 1e30;
+    double best_jit = 1e30;
+    size_t tokens = 0, nodes = 0, tree_bytes = 0;
+
+    for (int run = 0; run < runs; run++) {
+        double start = now_seconds();
+        tokens = lex_all(source, length);
+        double elapsed = now_seconds() - start;
+        if (elapsed < best_lex) best_lex = elapsed;
+    }
+
+    for (int run = 0; run < runs; run++) {
+        Arena *arena = arena_create();
+        Lexer *lexer = init_lexer(source, length, arena);
+        double start = now_seconds();
+        Ast *ast = parse(lexer);
+        double elapsed = now_seconds() - start;
+        if (elapsed < best_parse) best_parse = elapsed;
+        if (!ast) {
+            fprintf(stderr, "Failed to parse %s\n", path);
+            return 1;
+        }
+        nodes = ast->count - 1; // Less the reserved AST_NONE
+        tree_bytes = ast_bytes(ast);
+        free_ast(ast);
+        free_lexer(lexer);
+        arena_destroy(arena);
+    }
+
+    // Execution phases share one parsed and resolved program
+    Arena *arena = arena_create();
+    Lexer *lexer = init_lexer(source, length, arena);
+    Ast *ast = parse(lexer);
+    Resolution *resolution = resolve(ast);
+    Chunk *chunk = compile(ast, resolution);
+
+    Context ctx;
+    context_init(&ctx, io_standard());
+    silence_stdout();
+    for (int run = 0; run < runs; run++) {
+        context_bind(&ctx, resolution->slot_count, resolution->names);
+        double start = now_seconds();
+        interpret_program(&ctx, ast);
+        double elapsed = now_seconds() - start;
+        if (elapsed < best_interpret) best_interpret = elapsed;
+    }
+    for (int run = 0; run < runs; run++) {
+        context_bind(&ctx, resolution->slot_count, resolution->names);
+        ctx.jit = jit_create(ast); // Every run compiles its hot loops afresh
+        double start = now_seconds();
+        interpret_program(&ctx, ast);
+        double elapsed = now_seconds() - start;
+        jit_free(ctx.jit);
+        ctx.jit = NULL;
+        if (elapsed < best_jit) best_jit = elapsed;
+    }
+    for (int run = 0; run < runs; run++) {
+        context_bind(&ctx, resolution->slot_count, resolution->names);
+        double start = now_seconds();
+        run_chunk(&ctx, chunk);
+        double elapsed = now_seconds() - start;
+        if (elapsed < best_vm) best_vm = elapsed;
+    }
+    restore_stdout();
+    context_free(&ctx);
+
+    free_chunk(chunk);
+    free_resolution(resolution);
+    free_ast(ast);
+    free_lexer(lexer);
+    arena_destroy(arena);
+
+    // The same program through the whole optimising pipeline
+    arena = arena_create();
+    lexer = init_lexer(source, length, arena);
+    ast = parse(lexer);
+    resolution = resolve(ast);
+    optimize(ast, arena);
+    IrProgram *ir = ir_build(ast, resolution);
+    if (ir) {
+        ir_optimize(ir);
+        if (ir_lower(ir, resolution, ast)) {
+            optimize(ast, arena);
+        }
+        ir_free(ir);
+    }
+    infer_types(ast, resolution, 1);
+    chunk = compile(ast, resolution);
+
+    context_init(&ctx, io_standard());
+    silence_stdout();
+    for (int run = 0; run < runs; run++) {
+        context_bind(&ctx, resolution->slot_count, resolution->names);
+        double start = now_seconds();
+        run_chunk(&ctx, chunk);
+        double elapsed = now_seconds() - start;
+        if (elapsed < best_ssa_vm) best_ssa_vm = elapsed;
+    }
+    restore_stdout();
+    context_free(&ctx);
+
+    free_chunk(chunk);
+    free_resolution(resolution);
+    free_ast(ast);
+    free_lexer(lexer);
+    arena_destroy(arena);
+    munmap((void*)source, length);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("{\"workload\":\"%s\",\"bytes\":%zu,\"runs\":%d,"
+           "\"tokens\":%zu,\"nodes\":%zu,\"ast_bytes\":%zu,\"iterations\":%.0f,"
+           "\"lex_s\":%.6f,\"parse_s\":%.6f,\"interpret_s\":%.6f,\"jit_s\":%.6f,\"vm_s\":%.6f,\"ssa_vm_s\":%.6f,"
+           "\"tokens_per_s\":%.0f,\"nodes_per_s\":%.0f,"
+           "\"interpret_iterations_per_s\":%.0f,\"jit_iterations_per_s\":%.0f,\"vm_iterations_per_s\":%.0f,"
+           "\"ssa_vm_iterations_per_s\":%.0f,"
+           "\"peak_rss_kb\":%ld}\n",
+           name, length, runs, tokens, nodes, tree_bytes, iterations,
+           best_lex, best_parse, best_interpret, best_jit, best_vm, best_ssa_vm,
+           tokens / best_lex, nodes / best_parse,
+           iterations / best_interpret, iterations / best_jit, iterations / best_vm, iterations / best_ssa_vm,
+           usage.ru_maxrss);
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Generates the benchmark workloads into a directory and prints a manifest
+// line "<name> <path> <loop iterations>" for each one on stdout.
+//
+// Usage: workload_gen <output dir> [scale]
+#include <stdio.h>
+#include <stdlib.h>
+
+static FILE* open_workload(const char *dir, const char *name, char *path, size_t size) {
+    snprintf(path, size, "%s/%s.calc", dir, name);
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror("Failed to create workload");
+        exit(1);
+    }
+    return out;
+}
+
+// Identifiers are letters only, so variable indices are written in base 26
+static void write_variable(FILE *out, int index) {
+    char digits[16];
+    int n = 0;
+    do {
+        digits[n++] = (char)('a' + index % 26);
+        index /= 26;
+    } while (index > 0);
+    fputc('v', out);
+    while (n > 0) {
+        fputc(digits[--n], out);
+    }
+}
+
+// Nested arithmetic: every statement is an expression tree `depth` levels deep
+static long deep_arithmetic(FILE *out, int scale) {
+    int statements = 2000 * scale;
+    int depth = 48;
+    for (int s = 0; s < statements; s++) {
+        write_variable(out, s % 16);
+        fprintf(out, " = ");
+        for (int d = 0; d < depth; d++) {
+            fputc('(', out);
+        }
+        fprintf(out, "%d", s);
+        for (int d = 0; d < depth; d++) {
+            static const char *ops[] = {" + ", " * ", " - ", " / "};
+            fprintf(out, "%s%d)", ops[d % 4], d + 1);
+        }
+        fputc('\n', out);
+    }
+    fprintf(out, "print ");
+    write_variable(out, 0);
+    fputc('\n', out);
+    return 0;
+}
+
+// Straight-line code touching a large number of distinct variables
+static long many_variables(FILE *out, int scale) {
+    int count = 20000 * scale;
+    write_variable(out, 0);
+    fprintf(out, " = 0\n");
+    for (int i = 1; i < count; i++) {
+        write_variable(out, i);
+        fprintf(out, " = ");
+        write_variable(out, i - 1);
+        fprintf(out, " + %d\n", i);
+    }
+    fprintf(out, "print ");
+    write_variable(out, count - 1);
+    fputc('\n', out);
+    return 0;
+}
+
+// A long numeric while loop
+static long while_loop(FILE *out, int scale) {
+    long iterations = 2000000L * scale;
+    fprintf(out,
+            "i = 0\n"
+            "total = 0\n"
+            "while (i < %ld) {\n"
+            "    total = total + i * 2 - 1\n"
+            "    i = i + 1\n"
+            "}\n"
+            "print total\n", iterations);
+    return iterations;
+}
+
+// A loop recomputing invariant and repeated subexpressions on every pass
+static long loop_invariant(FILE *out, int scale) {
+    long iterations = 1000000L * scale;
+    fprintf(out,
+            "i = 0\n"
+            "k = 7\n"
+            "total = 0\n"
+            "while (i < %ld) {\n"
+            "    a = k * k + k / 3\n"
+            "    b = k * k + k / 3\n"
+            "    scratch = a * 2\n"
+            "    total = total + a * i - b\n"
+            "    i = i + 1\n"
+            "}\n"
+            "print total\n", iterations);
+    return iterations;
+}
+
+// Growing a string one piece per iteration, as tests/stage_5 does
+static long string_concat(FILE *out, int scale) {
+    long iterations = 200000L * scale;
+    fprintf(out,
+            "i = 0\n"
+            "list = \"\"\n"
+            "while (i < %ld) {\n"
+            "    list = list + \", \" + \"item \" + i\n"
+            "    i = i + 1\n"
+            "}\n"
+            "print list\n", iterations);
+    return iterations;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <output dir> [scale]\n", argv[0]);
+        return 1;
+    }
+    int scale = argc == 3 ? atoi(argv[2]) : 1;
+    if (scale < 1) scale = 1;
+
+    static const struct {
+        const char *name;
+        long (*generate)(FILE *out, int scale);
+    } workloads[] = {
+        {"deep_arithmetic", deep_arithmetic},
+        {"many_variables", many_variables},
+        {"while_loop", while_loop},
+        {"loop_invariant", loop_invariant},
+        {"string_concat", string_concat},
+    };
+
+    for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+        char path[4096];
+        FILE *out = open_workload(argv[1], workloads[i].name, path, sizeof(path));
+        long iterations = workloads[i].generate(out, scale);
+        fclose(out);
+        printf("%s %s %ld\n", workloads[i].name, path, iterations);
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "arena.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 16
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+// Header size rounded so block memory starts aligned
+#define ARENA_HEADER_SIZE align_up(sizeof(ArenaBlock))
+
+static ArenaBlock* new_block(size_t size) {
+    ArenaBlock *block = malloc(ARENA_HEADER_SIZE + size);
+    if (!block) {
+        fprintf(stderr, "Out of memory allocating arena block\n");
+        exit(1);
+    }
+    block->next = NULL;
+    block->used = 0;
+    block->size = size;
+    return block;
+}
+
+Arena* arena_create(void) {
+    Arena *arena = malloc(sizeof(Arena));
+    if (!arena) {
+        fprintf(stderr, "Out of memory allocating arena\n");
+        exit(1);
+    }
+    arena->head = new_block(ARENA_BLOCK_SIZE);
+    return arena;
+}
+
+void* arena_alloc(Arena *arena, size_t size) {
+    size = align_up(size);
+    ArenaBlock *block = arena->head;
+    if (block->used + size > block->size) {
+        if (size > ARENA_BLOCK_SIZE / 4) {
+            // Oversized requests get a dedicated block behind the current one
+            ArenaBlock *big = new_block(size);
+            big->used = size;
+            big->next = block->next;
+            block->next = big;
+            return (char*)big + ARENA_HEADER_SIZE;
+        }
+        block = new_block(ARENA_BLOCK_SIZE);
+        block->next = arena->head;
+        arena->head = block;
+    }
+    void *ptr = (char*)block + ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+    return ptr;
+}
+
+// Copy a byte span into the arena as a NUL-terminated string
+char* arena_strndup(Arena *arena, const char *chars, size_t length) {
+    char *copy = arena_alloc(arena, length + 1);
+    memcpy(copy, chars, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+void arena_destroy(Arena *arena) {
+    if (!arena) return;
+    ArenaBlock *block = arena->head;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
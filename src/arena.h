@@ -0,0 +1,24 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump-pointer arena. Everything allocated from an arena is released at once
+// by arena_destroy(); individual allocations are never freed.
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t size;
+    // Block memory follows the header
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head; // Block currently being filled
+} Arena;
+
+Arena* arena_create(void);
+void* arena_alloc(Arena *arena, size_t size);
+char* arena_strndup(Arena *arena, const char *chars, size_t length);
+void arena_destroy(Arena *arena);
+
+#endif // ARENA_H
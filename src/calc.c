@@ -0,0 +1,203 @@
+#include "calc.h"
+#include "arena.h"
+#include "lexer.h"
+#include "parser.h"
+#include "resolver.h"
+#include "optimizer.h"
+#include "types.h"
+#include "compiler.h"
+#include "vm.h"
+#include "context.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Everything a run needs, and nothing it changes. The AST is dropped once
+// the bytecode exists; the VM does not rewrite code as the tree walker does.
+struct CalcProgram {
+    Arena *arena;           // Interned names and string literals
+    Lexer *lexer;           // Kept for its intern table, to look names up
+    Resolution *resolution;
+    Chunk *chunk;
+};
+
+struct CalcBindings {
+    const CalcProgram *program;
+    Value *inputs;          // As last set, copied into the variables by each run
+    Context ctx;
+    Io io;
+};
+
+static void *checked_alloc(void *memory) {
+    if (!memory) {
+        fprintf(stderr, "Out of memory while compiling\n");
+        exit(1);
+    }
+    return memory;
+}
+
+CalcProgram* calc_compile(const char *source, size_t length, const char *const *inputs, int input_count) {
+    CalcProgram *program = checked_alloc(calloc(1, sizeof(CalcProgram)));
+    program->arena = arena_create();
+    program->lexer = init_lexer(source, length, program->arena);
+    Ast *ast = parse(program->lexer);
+    if (!ast) {
+        calc_free(program);
+        return NULL;
+    }
+
+    char **names = checked_alloc(malloc(((size_t)input_count + 1) * sizeof(char*)));
+    for (int i = 0; i < input_count; i++) {
+        names[i] = intern(&program->lexer->strings, inputs[i], strlen(inputs[i]));
+    }
+    program->resolution = resolve_with_inputs(ast, names, input_count);
+    free(names);
+    if (!program->resolution) {
+        free_ast(ast);
+        calc_free(program);
+        return NULL;
+    }
+
+    // The SSA passes are left out: they assume every variable starts
+    // undefined, which inputs do not
+    optimize(ast, program->arena);
+    infer_types(ast, program->resolution, 1);
+    program->chunk = compile(ast, program->resolution);
+    free_ast(ast);
+    if (!program->chunk) {
+        calc_free(program);
+        return NULL;
+    }
+    return program;
+}
+
+void calc_free(CalcProgram *program) {
+    if (!program) return;
+    free_chunk(program->chunk);
+    free_resolution(program->resolution);
+    free_lexer(program->lexer);
+    arena_destroy(program->arena);
+    free(program);
+}
+
+CalcBindings* calc_bindings_new(const CalcProgram *program) {
+    CalcBindings *bindings = checked_alloc(malloc(sizeof(CalcBindings)));
+    bindings->program = program;
+    bindings->inputs = checked_alloc(malloc(((size_t)program->resolution->input_count + 1) * sizeof(Value)));
+    for (int i = 0; i < program->resolution->input_count; i++) {
+        bindings->inputs[i] = UNDEFINED_VAL;
+    }
+    io_init(&bindings->io, IO_NONE, IO_NONE);
+    context_init(&bindings->ctx, &bindings->io);
+    context_bind(&bindings->ctx, program->resolution->slot_count, program->resolution->names);
+    return bindings;
+}
+
+void calc_bindings_free(CalcBindings *bindings) {
+    if (!bindings) return;
+    for (int i = 0; i < bindings->program->resolution->input_count; i++) {
+        value_release(bindings->inputs[i]);
+    }
+    free(bindings->inputs);
+    context_free(&bindings->ctx);
+    io_free(&bindings->io);
+    free(bindings);
+}
+
+// Slot of a variable of the program, or -1
+static int find_slot(const CalcProgram *program, const char *name) {
+    char *interned = intern_find(&program->lexer->strings, name, strlen(name));
+    return interned ? symbol_table_find(&program->resolution->symbols, interned) : -1;
+}
+
+int calc_set_var(CalcBindings *bindings, const char *name, CalcValue value) {
+    int slot = find_slot(bindings->program, name);
+    if (slot < 0 || slot >= bindings->program->resolution->input_count) {
+        return 0;
+    }
+    Value stored;
+    switch (value.type) {
+        case CALC_NUMBER:
+            stored = NUMBER_VAL(value.number);
+            break;
+        case CALC_BOOL:
+            stored = BOOL_VAL(value.boolean != 0);
+            break;
+        case CALC_STRING:
+            stored = BUILDER_VAL(string_builder_new(value.string, value.length, "", 0));
+            break;
+        default:
+            stored = UNDEFINED_VAL;
+            break;
+    }
+    value_release(bindings->inputs[slot]);
+    bindings->inputs[slot] = stored;
+    return 1;
+}
+
+int calc_run(CalcBindings *bindings) {
+    const CalcProgram *program = bindings->program;
+    Context *ctx = &bindings->ctx;
+    bindings->io.output_length = 0;
+    context_reset(ctx);
+    // The program may assign its inputs, so each run starts from a copy
+    for (int i = 0; i < program->resolution->input_count; i++) {
+        Value input = bindings->inputs[i];
+        if (IS_UNDEFINED(input)) {
+            context_fail(ctx, "Input not set: %s", program->resolution->names[i]);
+            return 0;
+        }
+        value_retain(input);
+        ctx->globals[i] = input;
+    }
+    return run_chunk(ctx, program->chunk);
+}
+
+int calc_get_var(CalcBindings *bindings, const char *name, CalcValue *value) {
+    int slot = find_slot(bindings->program, name);
+    if (slot < 0) {
+        return 0;
+    }
+    Value stored = bindings->ctx.globals[slot];
+    memset(value, 0, sizeof(CalcValue));
+    switch (value_type(stored)) {
+        case VAL_NUMBER:
+            value->type = CALC_NUMBER;
+            value->number = AS_NUMBER(stored);
+            break;
+        case VAL_BOOL:
+            value->type = CALC_BOOL;
+            value->boolean = AS_BOOL(stored);
+            break;
+        case VAL_STRING:
+        case VAL_BUILDER:
+            value->type = CALC_STRING;
+            value->string = value_chars(stored, &value->length, NULL); // Strings need no scratch
+            break;
+        default:
+            value->type = CALC_UNDEFINED;
+            break;
+    }
+    return 1;
+}
+
+const char* calc_output(const CalcBindings *bindings, size_t *length) {
+    *length = bindings->io.output_length;
+    return bindings->io.output ? bindings->io.output : "";
+}
+
+const char* calc_error(const CalcBindings *bindings) {
+    return bindings->ctx.error;
+}
+
+CalcValue calc_number_value(double number) {
+    return (CalcValue){CALC_NUMBER, number, 0, NULL, 0};
+}
+
+CalcValue calc_bool_value(int boolean) {
+    return (CalcValue){CALC_BOOL, 0, boolean, NULL, 0};
+}
+
+CalcValue calc_string_value(const char *chars, size_t length) {
+    return (CalcValue){CALC_STRING, 0, 0, chars, length};
+}
@@ -0,0 +1,86 @@
+#ifndef CALC_H
+#define CALC_H
+
+#include <stddef.h>
+
+// Embedding API: compile a program once, then run it any number of times.
+// calc_compile() parses, resolves, optimises, types and compiles the source
+// to bytecode; a run only executes that bytecode. A compiled program is never
+// changed by running it, so one program may be run by several threads at
+// once, each with CalcBindings of its own.
+//
+//     const char *inputs[] = {"price", "quantity"};
+//     CalcProgram *program = calc_compile(source, length, inputs, 2);
+//     CalcBindings *bindings = calc_bindings_new(program);
+//     for (each request) {
+//         calc_set_var(bindings, "price", calc_number_value(request->price));
+//         calc_set_var(bindings, "quantity", calc_number_value(request->quantity));
+//         if (calc_run(bindings)) {
+//             CalcValue total;
+//             calc_get_var(bindings, "total", &total);
+//         }
+//     }
+//     calc_bindings_free(bindings);
+//     calc_free(program);
+//
+// Link with libcalc.a and -lm -pthread.
+
+typedef struct CalcProgram CalcProgram;
+typedef struct CalcBindings CalcBindings;
+
+typedef enum {
+    CALC_UNDEFINED, // Not assigned by the run, or the run failed first
+    CALC_NUMBER,
+    CALC_STRING,
+    CALC_BOOL
+} CalcType;
+
+// A value crossing the API. Strings are a span, not NUL-terminated; one read
+// with calc_get_var() stays valid until the bindings are next run, set or
+// freed.
+typedef struct {
+    CalcType type;
+    double number;
+    int boolean;
+    const char *string;
+    size_t length;
+} CalcValue;
+
+// Compile `source`, whose variables named in `inputs` are set by the caller
+// before each run rather than assigned by the program. Returns NULL if the
+// source has an error, which is reported on stderr. The source need not
+// outlive the call.
+CalcProgram* calc_compile(const char *source, size_t length, const char *const *inputs, int input_count);
+void calc_free(CalcProgram *program);
+
+// Variables for running a program, one run at a time. Inputs start unset.
+// Program output is kept for calc_output(); input() reads end of input.
+// The program must outlive its bindings.
+CalcBindings* calc_bindings_new(const CalcProgram *program);
+void calc_bindings_free(CalcBindings *bindings);
+
+// Set an input of the program; it keeps its value across runs until set
+// again, even if a run assigns to it. Strings are copied. Returns 0 if
+// `name` is not an input.
+int calc_set_var(CalcBindings *bindings, const char *name, CalcValue value);
+
+// Run the program from the start. Inputs begin with the values last set and
+// every other variable undefined, and output from the last run is discarded.
+// Returns 1 if the program ran to the end, or 0 if it failed or an input was
+// never set, with the reason in calc_error().
+int calc_run(CalcBindings *bindings);
+
+// Read a variable as the last run left it. Returns 0 if the program has no
+// variable called `name`.
+int calc_get_var(CalcBindings *bindings, const char *name, CalcValue *value);
+
+const char* calc_output(const CalcBindings *bindings, size_t *length); // Printed by the last run
+const char* calc_error(const CalcBindings *bindings); // Why the last run failed, or ""
+
+// Values to pass to calc_set_var(). The names of the runtime of compiled
+// programs (runtime.h) are also calc_*, hence the suffix.
+CalcValue calc_number_value(double number);
+CalcValue calc_bool_value(int boolean);
+CalcValue calc_string_value(const char *chars, size_t length);
+
+#endif // CALC_H
@@ -0,0 +1,367 @@
+#include "compiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// An operator of the expression being compiled, waiting for its operands;
+// index counts the operands compiled so far
+typedef struct {
+    NodeId node;
+    uint32_t index;
+} OperatorFrame;
+
+typedef struct {
+    Ast *ast;
+    Chunk *chunk;
+    int depth; // Current operand stack depth while emitting
+    int failed; // A node could not be compiled; it has been reported
+    OperatorFrame *frames;
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+    size_t *jumps; // Short-circuit jumps of the open and / or operators
+    uint32_t jump_count;
+    uint32_t jump_capacity;
+} Compiler;
+
+static void emit_byte(Compiler *c, uint8_t byte) {
+    Chunk *chunk = c->chunk;
+    if (chunk->count == chunk->capacity) {
+        chunk->capacity = chunk->capacity ? chunk->capacity * 2 : 256;
+        chunk->code = realloc(chunk->code, chunk->capacity);
+        if (!chunk->code) {
+            fprintf(stderr, "Out of memory while compiling\n");
+            exit(1);
+        }
+    }
+    chunk->code[chunk->count++] = byte;
+}
+
+static void emit_operand(Compiler *c, uint32_t operand) {
+    for (int i = 0; i < 4; i++) {
+        emit_byte(c, (uint8_t)(operand >> (8 * i)));
+    }
+}
+
+static void patch_operand(Compiler *c, size_t at, uint32_t operand) {
+    for (int i = 0; i < 4; i++) {
+        c->chunk->code[at + i] = (uint8_t)(operand >> (8 * i));
+    }
+}
+
+// Track the operand stack so the VM can allocate it once up front
+static void adjust_depth(Compiler *c, int delta) {
+    c->depth += delta;
+    if (c->depth > c->chunk->max_stack) {
+        c->chunk->max_stack = c->depth;
+    }
+}
+
+static void emit_op(Compiler *c, OpCode op, int stack_delta) {
+    emit_byte(c, (uint8_t)op);
+    adjust_depth(c, stack_delta);
+}
+
+// Emit a jump with a placeholder target, returning where to patch it
+static size_t emit_jump(Compiler *c, OpCode op, int stack_delta) {
+    emit_op(c, op, stack_delta);
+    size_t at = c->chunk->count;
+    emit_operand(c, 0);
+    return at;
+}
+
+static void patch_jump_here(Compiler *c, size_t at) {
+    patch_operand(c, at, (uint32_t)c->chunk->count);
+}
+
+static uint32_t add_constant(Compiler *c, Value value) {
+    Chunk *chunk = c->chunk;
+    if (chunk->constant_count == chunk->constant_capacity) {
+        chunk->constant_capacity = chunk->constant_capacity ? chunk->constant_capacity * 2 : 64;
+        chunk->constants = realloc(chunk->constants, chunk->constant_capacity * sizeof(Value));
+        if (!chunk->constants) {
+            fprintf(stderr, "Out of memory while compiling\n");
+            exit(1);
+        }
+    }
+    chunk->constants[chunk->constant_count] = value;
+    return (uint32_t)chunk->constant_count++;
+}
+
+static void compile_statements(Compiler *c, NodeId block);
+
+// Opcode of a binary operator kind, or -1 for any other kind
+static int binary_opcode(TokenType kind) {
+    switch (kind) {
+        case TOKEN_PLUS:
+        case NODE_GUARDED_ADD_NUMBERS: // The tree walker's speculation is not carried over
+        case NODE_GUARDED_CONCAT:
+            return OP_ADD;
+        case TOKEN_MINUS: return OP_SUB;
+        case TOKEN_MUL: return OP_MUL;
+        case TOKEN_DIV: return OP_DIV;
+        case TOKEN_EQ:
+        case NODE_GUARDED_EQ_NUMBERS:
+        case NODE_GUARDED_EQ_STRINGS:
+            return OP_EQ;
+        case TOKEN_NEQ:
+        case NODE_GUARDED_NEQ_NUMBERS:
+        case NODE_GUARDED_NEQ_STRINGS:
+            return OP_NEQ;
+        case TOKEN_LT: return OP_LT;
+        case TOKEN_GT: return OP_GT;
+        case TOKEN_LTE: return OP_LTE;
+        case TOKEN_GTE: return OP_GTE;
+        case NODE_ADD_NUMBERS: return OP_ADD_NUMBERS;
+        case NODE_CONCAT: return OP_CONCAT;
+        case NODE_EQ_NUMBERS: return OP_EQ_NUMBERS;
+        case NODE_NEQ_NUMBERS: return OP_NEQ_NUMBERS;
+        case NODE_EQ_STRINGS: return OP_EQ_STRINGS;
+        case NODE_NEQ_STRINGS: return OP_NEQ_STRINGS;
+        default: return -1;
+    }
+}
+
+static int is_operator(Ast *ast, NodeId node) {
+    if (node == AST_NONE) return 0;
+    TokenType kind = ast_kind(ast, node);
+    return kind == TOKEN_AND || kind == TOKEN_OR || kind == TOKEN_NOT || kind == TOKEN_INPUT ||
+           binary_opcode(kind) >= 0;
+}
+
+// Compile a node without operands. A missing operand reads as 0.
+static void compile_leaf(Compiler *c, NodeId node) {
+    Ast *ast = c->ast;
+    switch (node == AST_NONE ? TOKEN_EOF : ast_kind(ast, node)) {
+        case TOKEN_NUMBER:
+            emit_op(c, OP_CONST, 1);
+            emit_operand(c, add_constant(c, NUMBER_VAL(ast_number(ast, node))));
+            break;
+        case TOKEN_STRING:
+            emit_op(c, OP_CONST, 1);
+            emit_operand(c, add_constant(c, STRING_VAL(ast_name(ast, node))));
+            break;
+        case TOKEN_TRUE:
+            emit_op(c, OP_TRUE, 1);
+            break;
+        case TOKEN_FALSE:
+            emit_op(c, OP_FALSE, 1);
+            break;
+        case TOKEN_IDENTIFIER:
+            emit_op(c, (ast->flags[node] & AST_CHECK_DEFINED) ? OP_GET_GLOBAL_CHECKED : OP_GET_GLOBAL, 1);
+            emit_operand(c, (uint32_t)ast->slots[node]);
+            break;
+        default:
+            if (node != AST_NONE) {
+                io_report(ast->diagnostics, "Unknown node type: %d", ast_kind(ast, node));
+                c->failed = 1;
+            }
+            emit_op(c, OP_CONST, 1);
+            emit_operand(c, add_constant(c, NUMBER_VAL(0)));
+            break;
+    }
+}
+
+static void *grow_stack(void *stack, uint32_t *capacity, size_t element_size) {
+    *capacity = *capacity ? *capacity * 2 : 64;
+    stack = realloc(stack, *capacity * element_size);
+    if (!stack) {
+        fprintf(stderr, "Out of memory while compiling\n");
+        exit(1);
+    }
+    return stack;
+}
+
+// Emit what comes after the frame's operator's first frame->index operands.
+// Returns 1 with the next operand to compile in *operand, or 0 once the
+// operator itself has been emitted.
+static int resume_operator(Compiler *c, OperatorFrame *frame, NodeId *operand) {
+    Ast *ast = c->ast;
+    NodeId node = frame->node;
+    TokenType kind = ast_kind(ast, node);
+    uint32_t index = frame->index++;
+    switch (kind) {
+        case TOKEN_AND:
+        case TOKEN_OR:
+            // Short-circuit: the jump leaves the decided result on the stack,
+            // otherwise it pops the left operand and falls into the right one
+            if (index == 0) {
+                *operand = ast->left[node];
+                return 1;
+            }
+            if (index == 1) {
+                if (c->jump_count == c->jump_capacity) {
+                    c->jumps = grow_stack(c->jumps, &c->jump_capacity, sizeof(size_t));
+                }
+                c->jumps[c->jump_count++] = emit_jump(c, kind == TOKEN_AND ? OP_AND : OP_OR, -1);
+                *operand = ast->right[node];
+                return 1;
+            }
+            emit_op(c, OP_TO_BOOL, 0);
+            patch_jump_here(c, c->jumps[--c->jump_count]);
+            return 0;
+        case TOKEN_NOT:
+        case TOKEN_INPUT:
+            if (index == 0) {
+                *operand = kind == TOKEN_NOT ? ast->right[node] : ast->left[node]; // Or the prompt
+                return 1;
+            }
+            emit_op(c, kind == TOKEN_NOT ? OP_NOT : OP_INPUT, 0);
+            return 0;
+        default:
+            if (kind == TOKEN_MINUS && ast->left[node] == AST_NONE) {
+                if (index == 0) {
+                    *operand = ast->right[node]; // Unary negation
+                    return 1;
+                }
+                emit_op(c, OP_NEG, 0);
+                return 0;
+            }
+            if (index < 2) {
+                *operand = index == 0 ? ast->left[node] : ast->right[node];
+                return 1;
+            }
+            emit_op(c, (OpCode)binary_opcode(kind), -1);
+            return 0;
+    }
+}
+
+// Compile an expression. Operators wait in frames on the heap while their
+// operands are compiled, so nesting depth costs no native stack.
+static void compile_expression(Compiler *c, NodeId node) {
+    for (;;) {
+        if (is_operator(c->ast, node)) {
+            if (c->frame_count == c->frame_capacity) {
+                c->frames = grow_stack(c->frames, &c->frame_capacity, sizeof(OperatorFrame));
+            }
+            c->frames[c->frame_count++] = (OperatorFrame){node, 0};
+        } else {
+            compile_leaf(c, node);
+        }
+        // Resume operators until one has another operand to compile
+        for (;;) {
+            if (c->frame_count == 0) return;
+            if (resume_operator(c, &c->frames[c->frame_count - 1], &node)) break;
+            c->frame_count--;
+        }
+    }
+}
+
+static void compile_statement(Compiler *c, NodeId node) {
+    Ast *ast = c->ast;
+    switch (ast_kind(ast, node)) {
+        case TOKEN_PRINT:
+            if (ast->left[node] != AST_NONE) {
+                compile_expression(c, ast->left[node]);
+                emit_op(c, OP_PRINT, -1);
+            }
+            break;
+        case TOKEN_ASSIGN:
+            compile_expression(c, ast->left[node]);
+            emit_op(c, OP_SET_GLOBAL, -1);
+            emit_operand(c, (uint32_t)ast->slots[node]);
+            break;
+        case TOKEN_WHILE:
+            {
+                size_t loop_start = c->chunk->count;
+                compile_expression(c, ast->left[node]);
+                size_t exit_jump = emit_jump(c, OP_JUMP_IF_FALSE, -1);
+                compile_statements(c, ast->right[node]);
+                emit_op(c, OP_JUMP, 0);
+                emit_operand(c, (uint32_t)loop_start);
+                patch_jump_here(c, exit_jump);
+            }
+            break;
+        case TOKEN_LBRACE:
+            compile_statements(c, node);
+            break;
+        default:
+            if (is_result_expression(ast_kind(ast, node))) {
+                compile_expression(c, node);
+                emit_op(c, OP_RESULT, -1);
+            }
+            break;
+    }
+}
+
+static void compile_statements(Compiler *c, NodeId block) {
+    for (uint32_t i = 0; i < ast_statement_count(c->ast, block); i++) {
+        compile_statement(c, ast_statements(c->ast, block)[i]);
+    }
+}
+
+// Compile a resolved program into a bytecode chunk. Returns NULL if part of
+// the program cannot be compiled, after reporting it to ast->diagnostics.
+Chunk* compile(Ast *ast, Resolution *resolution) {
+    Chunk *chunk = calloc(1, sizeof(Chunk));
+    if (!chunk) {
+        fprintf(stderr, "Out of memory while compiling\n");
+        exit(1);
+    }
+    chunk->global_count = (size_t)resolution->slot_count;
+    chunk->globals = malloc((chunk->global_count + 1) * sizeof(char*));
+    if (!chunk->globals) {
+        fprintf(stderr, "Out of memory while compiling\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < chunk->global_count; i++) {
+        chunk->globals[i] = resolution->names[i];
+    }
+    Compiler c = {ast, chunk, 0, 0, NULL, 0, 0, NULL, 0, 0};
+    compile_statements(&c, ast->root);
+    emit_op(&c, OP_HALT, 0);
+    free(c.frames);
+    free(c.jumps);
+    if (c.failed) {
+        free_chunk(chunk);
+        return NULL;
+    }
+    return chunk;
+}
+
+void free_chunk(Chunk *chunk) {
+    if (!chunk) return;
+    free(chunk->globals);
+    free(chunk->constants);
+    free(chunk->code);
+    free(chunk);
+}
+
+static uint32_t read_operand_at(const uint8_t *code) {
+    return (uint32_t)code[0] | ((uint32_t)code[1] << 8) |
+           ((uint32_t)code[2] << 16) | ((uint32_t)code[3] << 24);
+}
+
+// Utility function to print the bytecode of a chunk
+void disassemble_chunk(Chunk *chunk) {
+    static const char *names[] = {
+        "CONST", "TRUE", "FALSE", "GET_GLOBAL", "GET_GLOBAL_CHECKED", "SET_GLOBAL", "ADD", "SUB",
+        "MUL", "DIV", "NEG", "NOT", "EQ", "NEQ", "LT", "GT", "LTE", "GTE",
+        "ADD_NUMBERS", "CONCAT", "EQ_NUMBERS", "NEQ_NUMBERS", "EQ_STRINGS", "NEQ_STRINGS",
+        "TO_BOOL", "JUMP", "JUMP_IF_FALSE", "AND", "OR", "INPUT", "PRINT", "RESULT", "HALT"
+    };
+    size_t ip = 0;
+    while (ip < chunk->count) {
+        OpCode op = (OpCode)chunk->code[ip];
+        printf("%04zu %s", ip, names[op]);
+        ip++;
+        switch (op) {
+            case OP_CONST:
+            case OP_JUMP:
+            case OP_JUMP_IF_FALSE:
+            case OP_AND:
+            case OP_OR:
+                printf(" %u", read_operand_at(chunk->code + ip));
+                ip += 4;
+                break;
+            case OP_GET_GLOBAL:
+            case OP_GET_GLOBAL_CHECKED:
+            case OP_SET_GLOBAL:
+                printf(" %s", chunk->globals[read_operand_at(chunk->code + ip)]);
+                ip += 4;
+                break;
+            default:
+                break;
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdint.h>
+#include "parser.h"
+#include "interpreter.h"
+#include "resolver.h"
+
+// Bytecode instructions. Each opcode is one byte; operands are 32-bit
+// little-endian values stored inline after the opcode.
+typedef enum {
+    OP_CONST,         // operand: constant index
+    OP_TRUE,
+    OP_FALSE,
+    OP_GET_GLOBAL,    // operand: global slot
+    OP_GET_GLOBAL_CHECKED, // operand: global slot, errors if still undefined
+    OP_SET_GLOBAL,    // operand: global slot, pops the value
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_NEG,
+    OP_NOT,
+    OP_EQ,
+    OP_NEQ,
+    OP_LT,
+    OP_GT,
+    OP_LTE,
+    OP_GTE,
+    OP_ADD_NUMBERS,   // Operators whose operand types the type pass proved
+    OP_CONCAT,
+    OP_EQ_NUMBERS,
+    OP_NEQ_NUMBERS,
+    OP_EQ_STRINGS,
+    OP_NEQ_STRINGS,
+    OP_TO_BOOL,
+    OP_JUMP,          // operand: absolute target
+    OP_JUMP_IF_FALSE, // operand: absolute target, pops the condition
+    OP_AND,           // operand: absolute target, short-circuits on false
+    OP_OR,            // operand: absolute target, short-circuits on true
+    OP_INPUT,         // Replaces the prompt on top with the line read
+    OP_PRINT,
+    OP_RESULT,
+    OP_HALT
+} OpCode;
+
+typedef struct {
+    uint8_t *code;
+    size_t count;
+    size_t capacity;
+
+    Value *constants;
+    size_t constant_count;
+    size_t constant_capacity;
+
+    char **globals;      // Slot index -> interned variable name
+    size_t global_count;
+
+    int max_stack;       // Deepest operand stack the code can reach
+} Chunk;
+
+Chunk* compile(Ast *ast, Resolution *resolution);
+void free_chunk(Chunk *chunk);
+void disassemble_chunk(Chunk *chunk);
+
+#endif // COMPILER_H
@@ -0,0 +1,62 @@
+#include "context.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+void context_init(Context *ctx, Io *io) {
+    memset(ctx, 0, sizeof(Context));
+    ctx->io = io;
+}
+
+static void release_globals(Context *ctx) {
+    for (int i = 0; i < ctx->global_count; i++) {
+        value_release(ctx->globals[i]);
+    }
+}
+
+void context_bind(Context *ctx, int global_count, char **global_names) {
+    release_globals(ctx);
+    if (global_count > ctx->global_count || !ctx->globals) {
+        free(ctx->globals);
+        ctx->globals = malloc(((size_t)global_count + 1) * sizeof(Value));
+        if (!ctx->globals) {
+            fprintf(stderr, "Out of memory allocating globals\n");
+            exit(1);
+        }
+    }
+    ctx->global_count = global_count;
+    ctx->global_names = global_names;
+    for (int i = 0; i < global_count; i++) {
+        ctx->globals[i] = UNDEFINED_VAL;
+    }
+    ctx->failed = 0;
+    ctx->error[0] = '\0';
+}
+
+void context_reset(Context *ctx) {
+    for (int i = 0; i < ctx->global_count; i++) {
+        value_release(ctx->globals[i]);
+        ctx->globals[i] = UNDEFINED_VAL;
+    }
+    ctx->failed = 0;
+    ctx->error[0] = '\0';
+}
+
+void context_free(Context *ctx) {
+    release_globals(ctx);
+    free(ctx->globals);
+    free(ctx->frames);
+    ctx->globals = NULL;
+    ctx->global_names = NULL;
+    ctx->global_count = 0;
+    ctx->frames = ctx->frame_top = ctx->frame_end = NULL;
+}
+
+void context_fail(Context *ctx, const char *format, ...) {
+    if (ctx->failed) return;
+    ctx->failed = 1;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(ctx->error, sizeof(ctx->error), format, args);
+    va_end(args);
+}
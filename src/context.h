@@ -0,0 +1,54 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "io.h"
+#include "jit.h"
+#include "value.h"
+
+// Everything one run of a program reads and writes besides the program
+// itself: its variables, the tree walker's stack, its I/O and why it stopped.
+// Runs in different contexts share nothing, so they may go on at the same
+// time on different threads. Errors in a run are recorded here and returned
+// as a status instead of ending the process.
+#ifndef CONTEXT_ERROR_SIZE
+#define CONTEXT_ERROR_SIZE 256 // Longest error message kept, with its NUL
+#endif
+
+struct Frame;
+
+typedef struct {
+    Io *io;               // Where print writes and input() reads
+    Io *diagnostics;      // Where errors in the source are reported; NULL for stderr
+    Value *globals;       // Variables, in the slots the resolver assigned
+    char **global_names;
+    int global_count;
+
+    struct Frame *frames; // The tree walker's stack (see interpreter.c)
+    struct Frame *frame_top;
+    struct Frame *frame_end;
+    Jit *jit;             // Compiles hot loops of the tree walker; NULL for none
+
+    int failed;
+    char error[CONTEXT_ERROR_SIZE];
+} Context;
+
+void context_init(Context *ctx, Io *io);
+
+// Start a run: give every variable of the program a slot, undefined until
+// assigned, and clear the last error. Values left by an earlier run in the
+// context are released first.
+void context_bind(Context *ctx, int global_count, char **global_names);
+
+// Start another run of the same program: every variable is undefined again,
+// and the last error is cleared
+void context_reset(Context *ctx);
+
+// Release the variables and the tree walker's frames; the Io and the JIT
+// belong to the caller
+void context_free(Context *ctx);
+
+// Record why the run stops. Only the first error of a run is kept.
+void context_fail(Context *ctx, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+#endif // CONTEXT_H
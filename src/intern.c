@@ -0,0 +1,87 @@
+#include "intern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_INITIAL_CAPACITY 256
+
+// FNV-1a hash of a byte span
+static uint32_t hash_chars(const char *chars, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)chars[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static InternEntry* find_entry(InternEntry *table, size_t table_capacity,
+                               const char *chars, size_t length, uint32_t hash) {
+    size_t mask = table_capacity - 1;
+    size_t index = hash & mask;
+    for (;;) {
+        InternEntry *entry = &table[index];
+        if (!entry->chars || (entry->hash == hash && entry->length == length &&
+                              memcmp(entry->chars, chars, length) == 0)) {
+            return entry;
+        }
+        index = (index + 1) & mask; // Linear probing
+    }
+}
+
+static void grow(InternTable *t) {
+    size_t new_capacity = t->capacity ? t->capacity * 2 : INTERN_INITIAL_CAPACITY;
+    InternEntry *table = calloc(new_capacity, sizeof(InternEntry));
+    if (!table) {
+        fprintf(stderr, "Out of memory growing intern table\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < t->capacity; i++) {
+        InternEntry *old = &t->entries[i];
+        if (old->chars) {
+            *find_entry(table, new_capacity, old->chars, old->length, old->hash) = *old;
+        }
+    }
+    free(t->entries);
+    t->entries = table;
+    t->capacity = new_capacity;
+}
+
+void intern_table_init(InternTable *table, Arena *arena) {
+    table->entries = NULL;
+    table->capacity = 0;
+    table->count = 0;
+    table->arena = arena;
+}
+
+// Return the canonical copy of a byte span, adding it on first sight
+char* intern(InternTable *table, const char *chars, size_t length) {
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        grow(table);
+    }
+    uint32_t hash = hash_chars(chars, length);
+    InternEntry *entry = find_entry(table->entries, table->capacity, chars, length, hash);
+    if (!entry->chars) {
+        entry->chars = arena_strndup(table->arena, chars, length);
+        entry->length = length;
+        entry->hash = hash;
+        table->count++;
+    }
+    return entry->chars;
+}
+
+// Look a span up without adding it, so a finished table can be shared by
+// threads
+char* intern_find(const InternTable *table, const char *chars, size_t length) {
+    if (table->count == 0) return NULL;
+    InternEntry *entry = find_entry(table->entries, table->capacity, chars, length, hash_chars(chars, length));
+    return entry->chars;
+}
+
+// Release the lookup index; the interned strings stay in the arena
+void intern_table_free(InternTable *table) {
+    free(table->entries);
+    table->entries = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
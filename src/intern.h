@@ -0,0 +1,29 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+// String-interning table for one program. Every distinct identifier and
+// string literal is stored once in the program's arena, so interned strings
+// can be compared with == and live exactly as long as the parsed program.
+typedef struct {
+    char *chars;     // NUL-terminated arena copy, NULL for an empty entry
+    size_t length;
+    uint32_t hash;
+} InternEntry;
+
+typedef struct {
+    InternEntry *entries;
+    size_t capacity; // Always a power of two
+    size_t count;
+    Arena *arena;
+} InternTable;
+
+void intern_table_init(InternTable *table, Arena *arena);
+char* intern(InternTable *table, const char *chars, size_t length);
+char* intern_find(const InternTable *table, const char *chars, size_t length); // NULL if never interned
+void intern_table_free(InternTable *table);
+
+#endif // INTERN_H
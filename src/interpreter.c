@@ -1,306 +1,571 @@
 #include "interpreter.h"
+#include "trace.h"
+#include "profiler.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
-// Define a structure for a variable
-typedef struct {
-    char *name;
-    Value value;
-} Variable;
+// The tree walker keeps its own stack on the heap instead of recursing, so
+// native stack use stays constant however long or deeply nested the program
+// is. Every statement or operator being run owns a frame. The frame's task is
+// fixed when it is pushed, so resuming it is a single dispatch; its index
+// counts the operands evaluated so far. A finished frame hands its value to
+// the one below in `result`, and a left operand waits in its frame while the
+// right one is evaluated.
+typedef enum {
+    TASK_NONE,          // Statement that does nothing, such as a bare identifier
+    TASK_BLOCK,         // index = next statement
+    TASK_WHILE,         // index = 1 while the condition is being evaluated
+    TASK_PRINT,
+    TASK_ECHO,          // Expression statement, printed as "Result"
+    TASK_ASSIGN,
+    TASK_BINARY,        // Arithmetic and comparisons
+    TASK_NEGATE,
+    TASK_NOT,
+    TASK_AND,
+    TASK_OR,
+    TASK_INPUT,
+    TASK_UNKNOWN        // Expression of a kind the tree walker cannot evaluate
+} Task;
 
-#define MAX_GLOBALS 100 // Maximum number of global variables
-Variable globals[MAX_GLOBALS];
-int global_count = 0;
+typedef struct Frame {
+    Value left;       // Left operand of a binary operator, once evaluated
+    NodeId node;
+    uint32_t index;
+    uint8_t task;
+    uint8_t profiled; // Leaving the frame calls profile_exit()
+} Frame;
 
-// Get the value of a variable
-Value get_variable_value(const char *name) {
-    for (int i = 0; i < global_count; i++) {
-        if (strcmp(globals[i].name, name) == 0) {
-            return globals[i].value;
-        }
-    }
-    fprintf(stderr, "Undefined variable: %s\n", name);
-    exit(1);
-}
+// The task of each kind of node, as a statement and as an expression. Kinds
+// without an entry are TASK_NONE.
+static const uint8_t statement_tasks[AST_KIND_COUNT] = {
+    [TOKEN_LBRACE] = TASK_BLOCK,
+    [TOKEN_WHILE] = TASK_WHILE,
+    [TOKEN_PRINT] = TASK_PRINT,
+    [TOKEN_ASSIGN] = TASK_ASSIGN,
+    [TOKEN_PLUS] = TASK_ECHO, [TOKEN_MINUS] = TASK_ECHO, [TOKEN_MUL] = TASK_ECHO,
+    [TOKEN_DIV] = TASK_ECHO, [TOKEN_NUMBER] = TASK_ECHO, [TOKEN_STRING] = TASK_ECHO,
+    [TOKEN_LPAREN] = TASK_ECHO, [TOKEN_EQ] = TASK_ECHO, [TOKEN_NEQ] = TASK_ECHO,
+    [TOKEN_LT] = TASK_ECHO, [TOKEN_GT] = TASK_ECHO, [TOKEN_LTE] = TASK_ECHO,
+    [TOKEN_GTE] = TASK_ECHO, [TOKEN_AND] = TASK_ECHO, [TOKEN_OR] = TASK_ECHO,
+    [TOKEN_NOT] = TASK_ECHO, [TOKEN_TRUE] = TASK_ECHO, [TOKEN_FALSE] = TASK_ECHO,
+    [TOKEN_INPUT] = TASK_ECHO,
+    [NODE_ADD_NUMBERS] = TASK_ECHO, [NODE_CONCAT] = TASK_ECHO,
+    [NODE_EQ_NUMBERS] = TASK_ECHO, [NODE_NEQ_NUMBERS] = TASK_ECHO,
+    [NODE_EQ_STRINGS] = TASK_ECHO, [NODE_NEQ_STRINGS] = TASK_ECHO,
+    [NODE_GUARDED_ADD_NUMBERS] = TASK_ECHO, [NODE_GUARDED_CONCAT] = TASK_ECHO,
+    [NODE_GUARDED_EQ_NUMBERS] = TASK_ECHO, [NODE_GUARDED_NEQ_NUMBERS] = TASK_ECHO,
+    [NODE_GUARDED_EQ_STRINGS] = TASK_ECHO, [NODE_GUARDED_NEQ_STRINGS] = TASK_ECHO,
+};
 
-// Set the value of a variable
-void set_variable_value(const char *name, Value value) {
-    for (int i = 0; i < global_count; i++) {
-        if (strcmp(globals[i].name, name) == 0) {
-            globals[i].value = value;
-            return;
-        }
-    }
-    if (global_count >= MAX_GLOBALS) {
-        fprintf(stderr, "Too many global variables\n");
+static const uint8_t expression_tasks[AST_KIND_COUNT] = {
+    [TOKEN_PLUS] = TASK_BINARY, [TOKEN_MINUS] = TASK_BINARY, [TOKEN_MUL] = TASK_BINARY,
+    [TOKEN_DIV] = TASK_BINARY, [TOKEN_EQ] = TASK_BINARY, [TOKEN_NEQ] = TASK_BINARY,
+    [TOKEN_LT] = TASK_BINARY, [TOKEN_GT] = TASK_BINARY, [TOKEN_LTE] = TASK_BINARY,
+    [TOKEN_GTE] = TASK_BINARY,
+    [NODE_ADD_NUMBERS] = TASK_BINARY, [NODE_CONCAT] = TASK_BINARY,
+    [NODE_EQ_NUMBERS] = TASK_BINARY, [NODE_NEQ_NUMBERS] = TASK_BINARY,
+    [NODE_EQ_STRINGS] = TASK_BINARY, [NODE_NEQ_STRINGS] = TASK_BINARY,
+    [NODE_GUARDED_ADD_NUMBERS] = TASK_BINARY, [NODE_GUARDED_CONCAT] = TASK_BINARY,
+    [NODE_GUARDED_EQ_NUMBERS] = TASK_BINARY, [NODE_GUARDED_NEQ_NUMBERS] = TASK_BINARY,
+    [NODE_GUARDED_EQ_STRINGS] = TASK_BINARY, [NODE_GUARDED_NEQ_STRINGS] = TASK_BINARY,
+    [TOKEN_NOT] = TASK_NOT,
+    [TOKEN_AND] = TASK_AND,
+    [TOKEN_OR] = TASK_OR,
+    [TOKEN_INPUT] = TASK_INPUT,
+};
+
+// Expressions that are evaluated without a frame of their own. Node 0,
+// AST_NONE, is a TOKEN_EOF and reads as 0.
+static const uint8_t leaf_kinds[AST_KIND_COUNT] = {
+    [TOKEN_NUMBER] = 1, [TOKEN_STRING] = 1, [TOKEN_TRUE] = 1, [TOKEN_FALSE] = 1,
+    [TOKEN_IDENTIFIER] = 1, [TOKEN_EOF] = 1,
+};
+
+// The stack lives in the context and grows by doubling. run() keeps its top
+// in a local, like the VM's sp, and leaves it in frame_top when it returns.
+static Frame *grow_frames(Context *ctx, Frame *top) {
+    size_t depth = (size_t)(top - ctx->frames);
+    size_t capacity = ctx->frames ? (size_t)(ctx->frame_end - ctx->frames) * 2 : 256;
+    ctx->frames = realloc(ctx->frames, capacity * sizeof(Frame));
+    if (!ctx->frames) {
+        fprintf(stderr, "Out of memory while running\n");
         exit(1);
     }
-    globals[global_count].name = strdup(name);
-    globals[global_count].value = value;
-    global_count++;
+    ctx->frame_end = ctx->frames + capacity;
+    return ctx->frames + depth;
 }
 
-// Interpret an AST node
-void interpret(ASTNode *node) {
-    if (!node) return;
-
-    switch (node->type) {
-        case TOKEN_PRINT:
-            interpret_print(node);
-            break;
-        case TOKEN_ASSIGN:
-            {
-                Value value = evaluate_expression(node->left);
-                set_variable_value(node->name, value);
-            }
-            break;
-        case TOKEN_WHILE:
-            {
-                while (evaluate_expression(node->left).value.boolean) {
-                    interpret(node->body);
-                }
-            }
-            break;
-        default:
-            if (node->type == TOKEN_PLUS || node->type == TOKEN_MINUS ||
-                node->type == TOKEN_MUL || node->type == TOKEN_DIV ||
-                node->type == TOKEN_NUMBER || node->type == TOKEN_STRING ||
-                node->type == TOKEN_LPAREN || node->type == TOKEN_EQ ||
-                node->type == TOKEN_NEQ || node->type == TOKEN_LT ||
-                node->type == TOKEN_GT || node->type == TOKEN_LTE ||
-                node->type == TOKEN_GTE || node->type == TOKEN_AND ||
-                node->type == TOKEN_OR || node->type == TOKEN_NOT ||
-                node->type == TOKEN_TRUE || node->type == TOKEN_FALSE) {
-                Value result = evaluate_expression(node);
-                switch (result.type) {
-                    case VAL_STRING:
-                        printf("Result: %s\n", result.value.string);
-                        break;
-                    case VAL_BOOL:
-                        printf("Result: %s\n", result.value.boolean ? "True" : "False");
-                        break;
-                    case VAL_NUMBER:
-                    default:
-                        printf("Result: %f\n", result.value.number);
-                        break;
-                }
-            }
-            break;
+static inline Frame *push_frame(Context *ctx, Frame *fp, NodeId node, Task task, int profiled) {
+    if (fp == ctx->frame_end) {
+        fp = grow_frames(ctx, fp);
     }
+    fp->node = node;
+    fp->index = 0;
+    fp->task = (uint8_t)task;
+    fp->profiled = (uint8_t)profiled;
+    if (profiled) {
+        profile_enter(node);
+    }
+    return fp + 1;
+}
 
-    interpret(node->next); // Continue to the next statement in the sequence
+// Statements are profiled as frames of their own, except expression
+// statements whose expression already is one
+static inline Frame *push_statement(Context *ctx, Ast *ast, Frame *fp, NodeId node) {
+    Task task = (Task)statement_tasks[ast_kind(ast, node)];
+    return push_frame(ctx, fp, node, task,
+                      profiling_enabled && task != TASK_ECHO && task != TASK_NONE);
 }
 
-// Interpret a print statement
-void interpret_print(ASTNode *node) {
-    if (node->left) {
-        Value result = evaluate_expression(node->left);
-        switch (result.type) {
-            case VAL_STRING:
-                printf("Print: %s\n", result.value.string);
-                break;
-            case VAL_BOOL:
-                printf("Print: %s\n", result.value.boolean ? "True" : "False");
-                break;
-            case VAL_NUMBER:
-            default:
-                printf("Print: %f\n", result.value.number);
-                break;
-        }
+static inline Frame *push_expression(Context *ctx, Ast *ast, Frame *fp, NodeId node) {
+    Task task = (Task)expression_tasks[ast_kind(ast, node)];
+    if (task == TASK_BINARY && ast->left[node] == AST_NONE) {
+        task = TASK_NEGATE;
+    } else if (task == TASK_NONE) {
+        task = TASK_UNKNOWN;
     }
+    return push_frame(ctx, fp, node, task, profiling_enabled);
 }
 
-// Function to convert a number to a string
-char* number_to_string(double number) {
-    char buffer[64];
-    snprintf(buffer, sizeof(buffer), "%f", number);
-    return strdup(buffer);
+static void profile_leaf(NodeId node) {
+    profile_enter(node);
+    profile_exit();
 }
 
-// Function to convert a value to a string
-char* value_to_string(Value value) {
-    if (value.type == VAL_STRING) {
-        return strdup(value.value.string);
-    } else if (value.type == VAL_NUMBER) {
-        return number_to_string(value.value.number);
-    } else if (value.type == VAL_BOOL) {
-        return strdup(value.value.boolean ? "True" : "False");
+// A variable read before it is assigned fails the run. The undefined value
+// it reads as flows on until the statement using it checks for the failure.
+static inline Value read_variable(Context *ctx, Ast *ast, NodeId node) {
+    Value value = ctx->globals[ast->slots[node]];
+    if ((ast->flags[node] & AST_CHECK_DEFINED) && IS_UNDEFINED(value)) {
+        context_fail(ctx, "Undefined variable: %s", ctx->global_names[ast->slots[node]]);
+        return value;
     }
-    return strdup("");
+    value_retain(value);
+    return value;
 }
 
-// Evaluate an expression
-Value evaluate_expression(ASTNode *node) {
-    Value result;
-    if (!node) {
-        result.type = VAL_NUMBER;
-        result.value.number = 0;
-        return result;
-    }
-    printf("Evaluating node: type=%d, value=%f\n", node->type, node->value); // Debug: print node info
-
-    Value left_result, right_result;
-    char *left_str, *right_str;
-
-    switch (node->type) {
+static inline Value leaf_value(Context *ctx, Ast *ast, NodeId node) {
+    switch (ast_kind(ast, node)) {
         case TOKEN_NUMBER:
-            result.type = VAL_NUMBER;
-            result.value.number = node->value;
-            return result;
+            return NUMBER_VAL(ast_number(ast, node));
         case TOKEN_STRING:
-            result.type = VAL_STRING;
-            result.value.string = node->name;
-            return result;
+            return STRING_VAL(ast_name(ast, node));
         case TOKEN_TRUE:
-            result.type = VAL_BOOL;
-            result.value.boolean = 1;
-            return result;
+            return TRUE_VAL;
         case TOKEN_FALSE:
-            result.type = VAL_BOOL;
-            result.value.boolean = 0;
-            return result;
+            return FALSE_VAL;
         case TOKEN_IDENTIFIER:
-            return get_variable_value(node->name); // Retrieve the value of a variable
+            return read_variable(ctx, ast, node);
+        default:
+            return NUMBER_VAL(0); // AST_NONE
+    }
+}
+
+// Apply an arithmetic or comparison operator, consuming both operands
+static inline Value apply_binary(TokenType kind, Value left, Value right) {
+    Value result;
+    switch (kind) {
         case TOKEN_PLUS:
-            left_result = evaluate_expression(node->left);
-            right_result = evaluate_expression(node->right);
-            if (left_result.type == VAL_STRING || right_result.type == VAL_STRING) {
-                left_str = value_to_string(left_result);
-                right_str = value_to_string(right_result);
-                char *result_str = malloc(strlen(left_str) + strlen(right_str) + 1);
-                strcpy(result_str, left_str);
-                strcat(result_str, right_str);
-                free(left_str);
-                free(right_str);
-                result.type = VAL_STRING;
-                result.value.string = result_str;
+            if (IS_STRING(left) || IS_STRING(right)) {
+                result = concatenate_values(left, right);
+                value_release(left);
+                value_release(right);
                 return result;
             }
-            result.type = VAL_NUMBER;
-            result.value.number = left_result.value.number + right_result.value.number;
-            return result;
+            return NUMBER_VAL(value_as_number(left) + value_as_number(right));
         case TOKEN_MINUS:
-            result.type = VAL_NUMBER;
-            if (node->left) {
-                result.value.number = evaluate_expression(node->left).value.number - evaluate_expression(node->right).value.number;
-            } else {
-                result.value.number = -evaluate_expression(node->right).value.number; // Handle unary negation
-            }
-            return result;
+            value_release(left);
+            value_release(right);
+            return NUMBER_VAL(value_as_number(left) - value_as_number(right));
         case TOKEN_MUL:
-            result.type = VAL_NUMBER;
-            result.value.number = evaluate_expression(node->left).value.number * evaluate_expression(node->right).value.number;
-            return result;
+            value_release(left);
+            value_release(right);
+            return NUMBER_VAL(value_as_number(left) * value_as_number(right));
         case TOKEN_DIV:
-            result.type = VAL_NUMBER;
-            result.value.number = evaluate_expression(node->left).value.number / evaluate_expression(node->right).value.number;
-            return result;
+            value_release(left);
+            value_release(right);
+            return NUMBER_VAL(value_as_number(left) / value_as_number(right));
         case TOKEN_EQ:
-            left_result = evaluate_expression(node->left);
-            right_result = evaluate_expression(node->right);
-            result.type = VAL_BOOL;
-            if (left_result.type == VAL_STRING || right_result.type == VAL_STRING) {
-                left_str = value_to_string(left_result);
-                right_str = value_to_string(right_result);
-                result.value.boolean = strcmp(left_str, right_str) == 0;
-                free(left_str);
-                free(right_str);
-            } else {
-                printf("Evaluating EQ: left=%f, right=%f\n", left_result.value.number, right_result.value.number);
-                result.value.boolean = left_result.value.number == right_result.value.number;
+            if (!IS_STRING(left) && !IS_STRING(right)) {
+                TRACE(TRACE_EVAL, TRACE_DEBUG, "EQ: left=%f, right=%f", value_as_number(left), value_as_number(right));
             }
+            result = BOOL_VAL(values_equal(left, right));
+            value_release(left);
+            value_release(right);
             return result;
         case TOKEN_NEQ:
-            left_result = evaluate_expression(node->left);
-            right_result = evaluate_expression(node->right);
-            result.type = VAL_BOOL;
-            if (left_result.type == VAL_STRING || right_result.type == VAL_STRING) {
-                left_str = value_to_string(left_result);
-                right_str = value_to_string(right_result);
-                result.value.boolean = strcmp(left_str, right_str) != 0;
-                free(left_str);
-                free(right_str);
-            } else {
-                printf("Evaluating NEQ: left=%f, right=%f\n", left_result.value.number, right_result.value.number);
-                result.value.boolean = left_result.value.number != right_result.value.number;
+            if (!IS_STRING(left) && !IS_STRING(right)) {
+                TRACE(TRACE_EVAL, TRACE_DEBUG, "NEQ: left=%f, right=%f", value_as_number(left), value_as_number(right));
             }
+            result = BOOL_VAL(!values_equal(left, right));
+            value_release(left);
+            value_release(right);
             return result;
         case TOKEN_LT:
-            left_result = evaluate_expression(node->left);
-            right_result = evaluate_expression(node->right);
-            printf("Evaluating LT: left=%f, right=%f\n", left_result.value.number, right_result.value.number);
-            result.type = VAL_BOOL;
-            result.value.boolean = left_result.value.number < right_result.value.number;
-            return result;
+            TRACE(TRACE_EVAL, TRACE_DEBUG, "LT: left=%f, right=%f", value_as_number(left), value_as_number(right));
+            value_release(left);
+            value_release(right);
+            return BOOL_VAL(value_as_number(left) < value_as_number(right));
         case TOKEN_GT:
-            left_result = evaluate_expression(node->left);
-            right_result = evaluate_expression(node->right);
-            printf("Evaluating GT: left=%f, right=%f\n", left_result.value.number, right_result.value.number);
-            result.type = VAL_BOOL;
-            result.value.boolean = left_result.value.number > right_result.value.number;
-            return result;
+            TRACE(TRACE_EVAL, TRACE_DEBUG, "GT: left=%f, right=%f", value_as_number(left), value_as_number(right));
+            value_release(left);
+            value_release(right);
+            return BOOL_VAL(value_as_number(left) > value_as_number(right));
         case TOKEN_LTE:
-            left_result = evaluate_expression(node->left);
-            right_result = evaluate_expression(node->right);
-            printf("Evaluating LTE: left=%f, right=%f\n", left_result.value.number, right_result.value.number);
-            result.type = VAL_BOOL;
-            result.value.boolean = left_result.value.number <= right_result.value.number;
+            TRACE(TRACE_EVAL, TRACE_DEBUG, "LTE: left=%f, right=%f", value_as_number(left), value_as_number(right));
+            value_release(left);
+            value_release(right);
+            return BOOL_VAL(value_as_number(left) <= value_as_number(right));
+        // Kinds whose operand types the type pass proved or apply_node()
+        // checked: no tag checks, and numbers and literals need no release
+        case NODE_ADD_NUMBERS:
+        case NODE_GUARDED_ADD_NUMBERS:
+            return NUMBER_VAL(AS_NUMBER(left) + AS_NUMBER(right));
+        case NODE_CONCAT:
+        case NODE_GUARDED_CONCAT:
+            result = concatenate_values(left, right);
+            value_release(left);
+            value_release(right);
             return result;
-        case TOKEN_GTE:
-            left_result = evaluate_expression(node->left);
-            right_result = evaluate_expression(node->right);
-            printf("Evaluating GTE: left=%f, right=%f\n", left_result.value.number, right_result.value.number);
-            result.type = VAL_BOOL;
-            result.value.boolean = left_result.value.number >= right_result.value.number;
+        case NODE_EQ_NUMBERS:
+        case NODE_GUARDED_EQ_NUMBERS:
+            TRACE(TRACE_EVAL, TRACE_DEBUG, "EQ: left=%f, right=%f", AS_NUMBER(left), AS_NUMBER(right));
+            return BOOL_VAL(AS_NUMBER(left) == AS_NUMBER(right));
+        case NODE_NEQ_NUMBERS:
+        case NODE_GUARDED_NEQ_NUMBERS:
+            TRACE(TRACE_EVAL, TRACE_DEBUG, "NEQ: left=%f, right=%f", AS_NUMBER(left), AS_NUMBER(right));
+            return BOOL_VAL(AS_NUMBER(left) != AS_NUMBER(right));
+        case NODE_EQ_STRINGS:
+        case NODE_GUARDED_EQ_STRINGS:
+            result = BOOL_VAL(strings_equal(left, right));
+            value_release(left);
+            value_release(right);
             return result;
-        case TOKEN_AND:
-            left_result = evaluate_expression(node->left);
-            printf("Evaluating AND: left=%f\n", left_result.value.number);
-            if (!left_result.value.boolean) {
-                result.type = VAL_BOOL;
-                result.value.boolean = 0;
-                return result; // Short-circuit evaluation
-            }
-            right_result = evaluate_expression(node->right);
-            printf("Evaluating AND: right=%f\n", right_result.value.number);
-            result.type = VAL_BOOL;
-            result.value.boolean = left_result.value.boolean && right_result.value.boolean;
+        case NODE_NEQ_STRINGS:
+        case NODE_GUARDED_NEQ_STRINGS:
+            result = BOOL_VAL(!strings_equal(left, right));
+            value_release(left);
+            value_release(right);
             return result;
-        case TOKEN_OR:
-            left_result = evaluate_expression(node->left);
-            printf("Evaluating OR: left=%f\n", left_result.value.number);
-            if (left_result.value.boolean) {
-                result.type = VAL_BOOL;
-                result.value.boolean = 1;
-                return result; // Short-circuit evaluation
+        case TOKEN_GTE:
+        default:
+            TRACE(TRACE_EVAL, TRACE_DEBUG, "GTE: left=%f, right=%f", value_as_number(left), value_as_number(right));
+            value_release(left);
+            value_release(right);
+            return BOOL_VAL(value_as_number(left) >= value_as_number(right));
+    }
+}
+
+// Guarded kind for a generic operator given the operand types it meets, or
+// the operator itself if they are mixed
+static TokenType speculate(TokenType kind, Value left, Value right) {
+    int numbers = IS_NUMBER(left) && IS_NUMBER(right);
+    int strings = IS_STRING(left) && IS_STRING(right);
+    switch (kind) {
+        case TOKEN_PLUS:
+            return numbers ? NODE_GUARDED_ADD_NUMBERS : strings ? NODE_GUARDED_CONCAT : kind;
+        case TOKEN_EQ:
+            return numbers ? NODE_GUARDED_EQ_NUMBERS : strings ? NODE_GUARDED_EQ_STRINGS : kind;
+        default: // TOKEN_NEQ
+            return numbers ? NODE_GUARDED_NEQ_NUMBERS : strings ? NODE_GUARDED_NEQ_STRINGS : kind;
+    }
+}
+
+// A guard failed: put the node back to its generic kind for good
+static Value deoptimize(Ast *ast, NodeId node, Value left, Value right) {
+    TokenType kind;
+    switch (ast_kind(ast, node)) {
+        case NODE_GUARDED_ADD_NUMBERS: case NODE_GUARDED_CONCAT: kind = TOKEN_PLUS; break;
+        case NODE_GUARDED_EQ_NUMBERS: case NODE_GUARDED_EQ_STRINGS: kind = TOKEN_EQ; break;
+        default: kind = TOKEN_NEQ; break;
+    }
+    TRACE(TRACE_EVAL, TRACE_INFO, "node %u: guard failed, back to kind %d", node, kind);
+    ast->kinds[node] = (uint8_t)kind;
+    ast->flags[node] |= AST_GENERIC;
+    return apply_binary(kind, left, right);
+}
+
+// Apply the operator of `node` with type feedback. The first time a generic
+// +, == or != runs, it rewrites itself into the guarded kind for the operand
+// types it meets; a guarded kind checks them on every run and deoptimises
+// when they differ. A node that met mixed types stays generic.
+static inline Value apply_node(Ast *ast, NodeId node, Value left, Value right) {
+    TokenType kind = ast_kind(ast, node);
+    switch (kind) {
+        case NODE_GUARDED_ADD_NUMBERS:
+        case NODE_GUARDED_EQ_NUMBERS:
+        case NODE_GUARDED_NEQ_NUMBERS:
+            if (IS_NUMBER(left) && IS_NUMBER(right)) {
+                return apply_binary(kind, left, right);
             }
-            right_result = evaluate_expression(node->right);
-            printf("Evaluating OR: right=%f\n", right_result.value.number);
-            result.type = VAL_BOOL;
-            result.value.boolean = left_result.value.boolean || right_result.value.boolean;
-            return result;
-        case TOKEN_NOT:
-            right_result = evaluate_expression(node->right);
-            printf("Evaluating NOT: right=%f\n", right_result.value.number);
-            result.type = VAL_BOOL;
-            result.value.boolean = !right_result.value.boolean;
-            return result;
+            return deoptimize(ast, node, left, right);
+        case NODE_GUARDED_CONCAT:
+        case NODE_GUARDED_EQ_STRINGS:
+        case NODE_GUARDED_NEQ_STRINGS:
+            if (IS_STRING(left) && IS_STRING(right)) {
+                return apply_binary(kind, left, right);
+            }
+            return deoptimize(ast, node, left, right);
+        case TOKEN_PLUS:
+        case TOKEN_EQ:
+        case TOKEN_NEQ:
+            if (!(ast->flags[node] & AST_GENERIC)) {
+                TokenType guarded = speculate(kind, left, right);
+                if (guarded == kind) {
+                    ast->flags[node] |= AST_GENERIC;
+                } else {
+                    TRACE(TRACE_EVAL, TRACE_INFO, "node %u: kind %d specialised to %d", node, kind, guarded);
+                    ast->kinds[node] = (uint8_t)guarded;
+                }
+            }
+            return apply_binary(kind, left, right);
         default:
-            printf("Unknown node type: %d\n", node->type); // Debug: unknown node type
-            result.type = VAL_NUMBER;
-            result.value.number = 0;
-            return result;
+            return apply_binary(kind, left, right);
+    }
+}
+
+// Evaluate an expression that needs no frame into *value, or return 0 when it
+// needs one. Besides leaves this covers binary operators on two leaves, the
+// bulk of most programs; under the profiler they take frames so that the
+// operator gets a profile entry of its own.
+static inline int simple_value(Context *ctx, Ast *ast, NodeId node, Value *value) {
+    TokenType kind = ast_kind(ast, node);
+    if (leaf_kinds[kind]) {
+        if (profiling_enabled && node != AST_NONE) {
+            profile_leaf(node);
+        }
+        *value = leaf_value(ctx, ast, node);
+        return 1;
+    }
+    NodeId left = ast->left[node], right = ast->right[node];
+    if (expression_tasks[kind] == TASK_BINARY && left != AST_NONE && !profiling_enabled &&
+        leaf_kinds[ast_kind(ast, left)] && leaf_kinds[ast_kind(ast, right)]) {
+        TRACE(TRACE_EVAL, TRACE_DEBUG, "node: type=%d, index=%u", kind, node);
+        Value left_value = leaf_value(ctx, ast, left);
+        *value = apply_node(ast, node, left_value, leaf_value(ctx, ast, right));
+        return 1;
+    }
+    return 0;
+}
+
+// Run an assignment of a simple expression in place, or return 0 when the
+// statement needs a frame or the run has failed
+static inline int assign_simple(Context *ctx, Ast *ast, NodeId statement) {
+    Value value;
+    if (ast_kind(ast, statement) != TOKEN_ASSIGN || profiling_enabled ||
+        !simple_value(ctx, ast, ast->left[statement], &value)) {
+        return 0;
+    }
+    if (ctx->failed) {
+        value_release(value);
+        return 0;
+    }
+    value_release(ctx->globals[ast->slots[statement]]); // Drop the value being overwritten
+    ctx->globals[ast->slots[statement]] = value;
+    return 1;
+}
+
+// Evaluate an operand of the frame being run into `result`. A simple
+// expression is evaluated on the spot and the frame carries on; anything else
+// gets a frame of its own, which the next turn of the loop picks up.
+#define EVALUATE(operand) \
+    if (!simple_value(ctx, ast, (operand), &result)) { \
+        fp = push_expression(ctx, ast, fp, (operand)); \
+        continue; \
+    }
+
+// Stop the run if evaluating an operand failed, before its value is used
+// for anything that shows. Operators pass a failed operand on unchecked.
+#define CHECK_FAILED() \
+    if (ctx->failed) { \
+        value_release(result); \
+        goto failed; \
+    }
+
+// Evaluate the single operand of a frame into `result` unless that has
+// already been done
+#define OPERAND(operand) \
+    if (frame->index == 0) { \
+        frame->index = 1; \
+        EVALUATE(operand); \
+    }
+
+// Run frames until the stack is back down to `base` frames and return the
+// value the last one finished with. Each turn resumes the top frame and takes
+// it as far as it can go: simple operands are evaluated in place, and only a
+// nested operator or statement makes the loop come round again. Nothing here
+// calls back into run().
+static Value run(Context *ctx, Ast *ast, size_t base) {
+    Frame *fp = ctx->frame_top;
+    Frame *frame;
+    NodeId node;
+    Value result = NUMBER_VAL(0);
+
+    while (fp > ctx->frames + base) {
+        frame = fp - 1;
+        node = frame->node;
+
+        switch ((Task)frame->task) {
+            case TASK_BLOCK:
+                // Assignments of simple expressions need no frame either
+                while (frame->index < ast_statement_count(ast, node) &&
+                       assign_simple(ctx, ast, ast_statements(ast, node)[frame->index])) {
+                    frame->index++;
+                }
+                if (ctx->failed) {
+                    goto failed;
+                }
+                if (frame->index < ast_statement_count(ast, node)) {
+                    fp = push_statement(ctx, ast, fp, ast_statements(ast, node)[frame->index++]);
+                    continue;
+                }
+                break;
+            case TASK_WHILE:
+                OPERAND(ast->left[node]);
+                CHECK_FAILED();
+                value_release(result);
+                if (value_as_bool(result)) {
+                    // A hot numeric loop may run its remaining iterations as machine code
+                    if (ctx->jit && !profiling_enabled && jit_loop(ctx->jit, ast, node, ctx->globals)) {
+                        break;
+                    }
+                    frame->index = 0; // Test the condition again after the body
+                    fp = push_statement(ctx, ast, fp, ast->right[node]);
+                    continue;
+                }
+                break;
+            case TASK_PRINT:
+                if (ast->left[node] == AST_NONE) {
+                    break;
+                }
+                OPERAND(ast->left[node]);
+                CHECK_FAILED();
+                print_value(ctx->io, "Print", result);
+                value_release(result);
+                break;
+            case TASK_ECHO:
+                OPERAND(node);
+                CHECK_FAILED();
+                print_value(ctx->io, "Result", result);
+                value_release(result);
+                break;
+            case TASK_ASSIGN:
+                OPERAND(ast->left[node]);
+                CHECK_FAILED();
+                value_release(ctx->globals[ast->slots[node]]); // Drop the value being overwritten
+                ctx->globals[ast->slots[node]] = result;
+                break;
+            case TASK_BINARY:
+                if (frame->index == 0) {
+                    TRACE(TRACE_EVAL, TRACE_DEBUG, "node: type=%d, index=%u", ast_kind(ast, node), node);
+                    frame->index = 1;
+                    EVALUATE(ast->left[node]);
+                }
+                if (frame->index == 1) {
+                    frame->left = result;
+                    frame->index = 2;
+                    EVALUATE(ast->right[node]);
+                }
+                result = apply_node(ast, node, frame->left, result);
+                break;
+            case TASK_NEGATE:
+                OPERAND(ast->right[node]);
+                value_release(result);
+                result = NUMBER_VAL(-value_as_number(result));
+                break;
+            case TASK_NOT:
+                OPERAND(ast->right[node]);
+                TRACE(TRACE_EVAL, TRACE_DEBUG, "NOT: right=%f", AS_NUMBER(result));
+                value_release(result);
+                result = BOOL_VAL(!value_as_bool(result));
+                break;
+            case TASK_AND:
+            case TASK_OR:
+                if (frame->index == 0) {
+                    frame->index = 1;
+                    EVALUATE(ast->left[node]);
+                }
+                if (frame->index == 1) {
+                    int is_or = frame->task == TASK_OR;
+                    TRACE(TRACE_EVAL, TRACE_DEBUG, "%s: left=%f", is_or ? "OR" : "AND", AS_NUMBER(result));
+                    value_release(result);
+                    if (value_as_bool(result) == is_or) {
+                        result = BOOL_VAL(is_or); // Short-circuit evaluation
+                        break;
+                    }
+                    frame->index = 2;
+                    EVALUATE(ast->right[node]);
+                }
+                TRACE(TRACE_EVAL, TRACE_DEBUG, "%s: right=%f", frame->task == TASK_OR ? "OR" : "AND",
+                      AS_NUMBER(result));
+                value_release(result);
+                result = BOOL_VAL(value_as_bool(result));
+                break;
+            case TASK_INPUT:
+                OPERAND(ast->left[node]);
+                CHECK_FAILED();
+                frame->left = result; // The prompt
+                result = read_input(ctx->io, frame->left);
+                value_release(frame->left);
+                break;
+            case TASK_UNKNOWN:
+                context_fail(ctx, "Unknown node type: %d", ast_kind(ast, node));
+                result = NUMBER_VAL(0);
+                break;
+            case TASK_NONE:
+                break;
+        }
+
+        // The node is finished: pop its frame
+        if ((--fp)->profiled) {
+            profile_exit();
+        }
     }
+
+    ctx->frame_top = fp;
+    return result;
+
+failed:
+    // Drop the frames still running, with the left operands they hold
+    while (fp > ctx->frames + base) {
+        fp--;
+        if (fp->task == TASK_BINARY && fp->index == 2) {
+            value_release(fp->left);
+        }
+        if (fp->profiled) {
+            profile_exit();
+        }
+    }
+    ctx->frame_top = fp;
+    return NUMBER_VAL(0);
+}
+
+// Run a statement. Returns 1, or 0 if the run failed (see ctx->error).
+int interpret(Context *ctx, Ast *ast, NodeId node) {
+    size_t base = (size_t)(ctx->frame_top - ctx->frames);
+    ctx->frame_top = push_statement(ctx, ast, ctx->frame_top, node);
+    run(ctx, ast, base);
+    return !ctx->failed;
 }
 
-// Free the AST nodes
-void free_ast(ASTNode *node) {
-    if (!node) return;
-    free_ast(node->left);
-    free_ast(node->right);
-    if (node->type == TOKEN_STRING && node->name) {
-        free(node->name);
+// Run a whole program: its top-level statements in order. The root block is
+// not a statement of its own, so it gets no profiler frame.
+int interpret_program(Context *ctx, Ast *ast) {
+    size_t base = (size_t)(ctx->frame_top - ctx->frames);
+    ctx->frame_top = push_frame(ctx, ctx->frame_top, ast->root, TASK_BLOCK, 0);
+    run(ctx, ast, base);
+    return !ctx->failed;
+}
+
+// Evaluate an expression. The caller owns the returned value, which is
+// meaningless if ctx->failed is set.
+Value evaluate_expression(Context *ctx, Ast *ast, NodeId node) {
+    Value value;
+    if (simple_value(ctx, ast, node, &value)) {
+        return value;
     }
-    free(node);
+    size_t base = (size_t)(ctx->frame_top - ctx->frames);
+    ctx->frame_top = push_expression(ctx, ast, ctx->frame_top, node);
+    return run(ctx, ast, base);
 }
@@ -2,25 +2,12 @@
 #define INTERPRETER_H
 
 #include "parser.h"
+#include "context.h"
 
-typedef enum {
-    VAL_NUMBER,
-    VAL_STRING,
-    VAL_BOOL
-} ValueType;
-
-typedef struct {
-    ValueType type;
-    union {
-        double number;
-        char *string;
-        int boolean;
-    } value;
-} Value;
-
-void interpret(ASTNode *node);
-void interpret_print(ASTNode *node);
-Value evaluate_expression(ASTNode *node);
-void free_ast(ASTNode *node);
+// Tree walker. Variables are the context's globals, which context_bind()
+// sizes from the program's Resolution before it runs.
+int interpret_program(Context *ctx, Ast *ast);
+int interpret(Context *ctx, Ast *ast, NodeId node);
+Value evaluate_expression(Context *ctx, Ast *ast, NodeId node);
 
 #endif // INTERPRETER_H
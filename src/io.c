@@ -0,0 +1,173 @@
+#include "io.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static Io standard;
+static int standard_started = 0; // Exit handler registered
+
+static void *checked_realloc(void *memory, size_t size) {
+    memory = realloc(memory, size);
+    if (!memory) {
+        fprintf(stderr, "Out of memory during program I/O\n");
+        exit(1);
+    }
+    return memory;
+}
+
+void io_init(Io *io, int output_fd, int input_fd) {
+    memset(io, 0, sizeof(Io));
+    io->output_fd = output_fd;
+    io->input_fd = input_fd;
+    io->line_buffered = output_fd != IO_NONE && isatty(output_fd);
+    io->input_eof = input_fd == IO_NONE;
+}
+
+void io_free(Io *io) {
+    io_flush(io);
+    free(io->output);
+    free(io->input);
+    io->output = io->input = NULL;
+    io->output_capacity = io->input_capacity = 0;
+}
+
+static void flush_standard(void) {
+    io_flush(&standard);
+}
+
+Io *io_standard(void) {
+    if (!standard_started) {
+        standard_started = 1;
+        io_init(&standard, STDOUT_FILENO, STDIN_FILENO);
+        atexit(flush_standard);
+    }
+    return &standard;
+}
+
+static void write_all(int fd, const char *chars, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, chars, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return; // Nowhere left to report it; drop the output as stdio would
+        }
+        chars += written;
+        length -= (size_t)written;
+    }
+}
+
+void io_flush(Io *io) {
+    if (io->output_fd == IO_NONE) {
+        return; // Kept for the caller
+    }
+    if (io->output_fd == STDOUT_FILENO) {
+        fflush(stdout);
+    }
+    write_all(io->output_fd, io->output, io->output_length);
+    io->output_length = 0;
+}
+
+void io_write(Io *io, const char *chars, size_t length) {
+    if (io->output_length + length > io->output_capacity) {
+        if (io->output_fd != IO_NONE) {
+            io_flush(io);
+            if (length > IO_FLUSH_THRESHOLD) {
+                write_all(io->output_fd, chars, length); // Too big to be worth copying
+                return;
+            }
+            if (!io->output) {
+                io->output_capacity = IO_FLUSH_THRESHOLD;
+                io->output = checked_realloc(NULL, io->output_capacity);
+            }
+        } else {
+            size_t capacity = io->output_capacity ? io->output_capacity : 256;
+            while (capacity < io->output_length + length) {
+                capacity *= 2;
+            }
+            io->output = checked_realloc(io->output, capacity);
+            io->output_capacity = capacity;
+        }
+    }
+    memcpy(io->output + io->output_length, chars, length);
+    io->output_length += length;
+}
+
+void io_newline(Io *io) {
+    io_write(io, "\n", 1);
+    if (io->line_buffered) {
+        io_flush(io);
+    }
+}
+
+void io_report(Io *io, const char *format, ...) {
+    char text[IO_REPORT_SIZE];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text) - 1, format, args);
+    va_end(args);
+    if (length < 0) return;
+    if ((size_t)length > sizeof(text) - 2) {
+        length = (int)sizeof(text) - 2; // Truncated
+    }
+    text[length++] = '\n';
+    if (io) {
+        io_write(io, text, (size_t)length);
+    } else {
+        fwrite(text, 1, (size_t)length, stderr);
+    }
+}
+
+// Read more input after what is buffered; returns 0 at end of input
+static int fill_input(Io *io) {
+    if (io->input_start > 0) {
+        memmove(io->input, io->input + io->input_start, io->input_end - io->input_start);
+        io->input_end -= io->input_start;
+        io->input_start = 0;
+    }
+    if (io->input_end == io->input_capacity) {
+        io->input_capacity = io->input_capacity ? io->input_capacity * 2 : IO_FLUSH_THRESHOLD;
+        io->input = checked_realloc(io->input, io->input_capacity);
+    }
+    for (;;) {
+        ssize_t count = read(io->input_fd, io->input + io->input_end, io->input_capacity - io->input_end);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) {
+            io->input_eof = 1;
+            return 0;
+        }
+        io->input_end += (size_t)count;
+        return 1;
+    }
+}
+
+int io_read_line(Io *io, const char **line, size_t *length) {
+    io_flush(io); // Show any prompt before waiting
+    size_t scanned = 0; // Bytes of the line already searched for '\n'
+    char *newline;
+    for (;;) {
+        size_t available = io->input_end - io->input_start;
+        newline = available > scanned ? memchr(io->input + io->input_start + scanned, '\n', available - scanned) : NULL;
+        if (newline) break;
+        scanned = available;
+        if (io->input_eof || !fill_input(io)) {
+            if (available == 0) {
+                return 0;
+            }
+            newline = io->input + io->input_end; // Last line, without a line ending
+            break;
+        }
+    }
+    *line = io->input + io->input_start;
+    *length = (size_t)(newline - *line);
+    io->input_start += *length;
+    if (newline < io->input + io->input_end) {
+        io->input_start++; // Past the '\n'
+    }
+    if (*length > 0 && (*line)[*length - 1] == '\r') {
+        (*length)--;
+    }
+    return 1;
+}
@@ -0,0 +1,61 @@
+#ifndef IO_H
+#define IO_H
+
+#include <stddef.h>
+
+// Program I/O, kept apart from stdio so that printing a value or reading a
+// line costs a copy rather than a system call. Each run of a program prints
+// into an Io of its own, so programs running on different threads never
+// share a buffer.
+//
+// Output collects in a buffer that is written to output_fd when it reaches
+// IO_FLUSH_THRESHOLD bytes and before input is read; on a terminal every
+// line is written as it ends, as people expect. An Io without an output_fd
+// keeps everything printed, for the caller to collect. Input is read from
+// input_fd in blocks; without one, every read is at end of input.
+#ifndef IO_FLUSH_THRESHOLD
+#define IO_FLUSH_THRESHOLD 65536 // Bytes of output held back
+#endif
+
+#define IO_NONE -1 // No file descriptor
+#define IO_REPORT_SIZE 512 // Longest line io_report() writes, with its newline
+
+typedef struct {
+    int output_fd;
+    char *output;
+    size_t output_length;
+    size_t output_capacity;
+    int line_buffered;
+
+    // Lines are handed out in place, and a line that runs past the end of
+    // the block is moved to the front before reading on
+    int input_fd;
+    char *input;
+    size_t input_capacity;
+    size_t input_start;  // First byte not yet handed out
+    size_t input_end;    // One past the last byte read
+    int input_eof;
+} Io;
+
+void io_init(Io *io, int output_fd, int input_fd);
+void io_free(Io *io); // Flushes first
+
+// The process's standard output and input, flushed when it exits. Anything
+// stdio printed first (dumps, disassembly) is flushed ahead of it, so the
+// two never interleave.
+Io *io_standard(void);
+
+void io_write(Io *io, const char *chars, size_t length);
+void io_newline(Io *io);
+void io_flush(Io *io);
+
+// Report a problem with a program as one line: kept in `io`, or written to
+// stderr in a single call if `io` is NULL, so that reports from programs
+// compiled on different threads never interleave
+void io_report(Io *io, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Read the next line of input, without its line ending, into *line. The
+// text stays valid until the next call. Returns 0 at end of input.
+int io_read_line(Io *io, const char **line, size_t *length);
+
+#endif // IO_H
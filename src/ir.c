@@ -0,0 +1,1247 @@
+#include "ir.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *grow_array(void *array, int *capacity, size_t element_size) {
+    *capacity = *capacity ? *capacity * 2 : 64;
+    array = realloc(array, (size_t)*capacity * element_size);
+    if (!array) {
+        fprintf(stderr, "Out of memory in the SSA pass\n");
+        exit(1);
+    }
+    return array;
+}
+
+static int new_block(IrProgram *ir, IrBlockKind kind, int parent, int owner) {
+    if (ir->block_count == ir->block_capacity) {
+        ir->blocks = grow_array(ir->blocks, &ir->block_capacity, sizeof(IrBlock));
+    }
+    IrBlock *block = &ir->blocks[ir->block_count];
+    block->kind = kind;
+    block->parent = parent;
+    block->owner = owner;
+    block->insts = NULL;
+    block->count = 0;
+    block->capacity = 0;
+    return ir->block_count++;
+}
+
+static void block_append(IrProgram *ir, int block, int id) {
+    IrBlock *b = &ir->blocks[block];
+    if (b->count == b->capacity) {
+        b->insts = grow_array(b->insts, &b->capacity, sizeof(int));
+    }
+    b->insts[b->count++] = id;
+}
+
+// Add an instruction at the end of `block` (-1 to leave it unplaced)
+static int new_inst(IrProgram *ir, IrOp op, int block, int line) {
+    if (ir->inst_count == ir->inst_capacity) {
+        ir->insts = grow_array(ir->insts, &ir->inst_capacity, sizeof(IrInst));
+    }
+    int id = ir->inst_count++;
+    IrInst *inst = &ir->insts[id];
+    memset(inst, 0, sizeof(IrInst));
+    inst->op = op;
+    inst->args[0] = inst->args[1] = -1;
+    inst->block = block;
+    inst->slot = -1;
+    inst->line = line;
+    inst->forward = -1;
+    inst->phis = inst->cond = inst->body = -1;
+    if (block >= 0) {
+        block_append(ir, block, id);
+    }
+    return id;
+}
+
+// Follow replacements made by the passes to the instruction that stands
+static int resolve_value(IrProgram *ir, int id) {
+    while (id >= 0 && ir->insts[id].forward >= 0) {
+        id = ir->insts[id].forward;
+    }
+    return id;
+}
+
+static int is_pure(IrOp op) {
+    return op == IR_CONST || (op >= IR_ADD && op <= IR_GTE);
+}
+
+// ---------------------------------------------------------------------------
+// Construction. Each variable's current value is tracked while walking the
+// statements in order; a loop gets a phi for every variable its body assigns.
+
+// An operator waiting for its operands: index counts those built, left
+// holds the first one's value (the instruction itself for and / or) and
+// saved the block to return to once an and / or operand is built
+typedef struct {
+    NodeId node;
+    int index;
+    int left;
+    int saved;
+} BuildFrame;
+
+typedef struct {
+    Ast *ast;
+    IrProgram *ir;
+    int *current;           // Slot -> value the variable holds at this point
+    unsigned char *marks;   // Scratch set of slots for collect_assigned()
+    int block;              // Block receiving new instructions
+    int failed;
+    BuildFrame *frames;     // Operators of the expression being built
+    int frame_count;
+    int frame_capacity;
+} Builder;
+
+static int emit(Builder *b, IrOp op, int left, int right, int line) {
+    int id = new_inst(b->ir, op, b->block, line);
+    b->ir->insts[id].args[0] = left;
+    b->ir->insts[id].args[1] = right;
+    return id;
+}
+
+// Literal node, or the number 0 for AST_NONE as the executors evaluate it
+static int emit_constant(Builder *b, NodeId node) {
+    Ast *ast = b->ast;
+    int id = emit(b, IR_CONST, -1, -1, ast->lines[node]);
+    IrInst *inst = &b->ir->insts[id];
+    inst->literal = node == AST_NONE ? TOKEN_NUMBER : ast_kind(ast, node);
+    if (inst->literal == TOKEN_NUMBER && node != AST_NONE) {
+        inst->number = ast_number(ast, node);
+    } else if (inst->literal == TOKEN_STRING) {
+        inst->string = ast_name(ast, node);
+    }
+    return id;
+}
+
+static const IrOp binary_ops[] = {
+    [TOKEN_PLUS] = IR_ADD, [TOKEN_MINUS] = IR_SUB, [TOKEN_MUL] = IR_MUL, [TOKEN_DIV] = IR_DIV,
+    [TOKEN_EQ] = IR_EQ, [TOKEN_NEQ] = IR_NEQ, [TOKEN_LT] = IR_LT, [TOKEN_GT] = IR_GT,
+    [TOKEN_LTE] = IR_LTE, [TOKEN_GTE] = IR_GTE, [TOKEN_AND] = IR_AND, [TOKEN_OR] = IR_OR,
+};
+
+// Value of a node without operands
+static int build_leaf(Builder *b, NodeId node) {
+    if (node == AST_NONE) {
+        return emit_constant(b, node);
+    }
+    Ast *ast = b->ast;
+    int slot = ast->slots[node];
+    int id;
+    switch (ast_kind(ast, node)) {
+        case TOKEN_NUMBER:
+        case TOKEN_STRING:
+        case TOKEN_TRUE:
+        case TOKEN_FALSE:
+            return emit_constant(b, node);
+        case TOKEN_IDENTIFIER:
+            if (ast->flags[node] & AST_CHECK_DEFINED) {
+                id = emit(b, IR_CHECK, b->current[slot], -1, ast->lines[node]);
+                b->ir->insts[id].slot = slot;
+                return id;
+            }
+            return b->current[slot];
+        default:
+            b->failed = 1;
+            return b->ir->undef;
+    }
+}
+
+static int has_operands(Ast *ast, NodeId node) {
+    if (node == AST_NONE) return 0;
+    switch (ast_kind(ast, node)) {
+        case TOKEN_PLUS: case TOKEN_MINUS: case TOKEN_MUL: case TOKEN_DIV:
+        case TOKEN_EQ: case TOKEN_NEQ: case TOKEN_LT: case TOKEN_GT: case TOKEN_LTE: case TOKEN_GTE:
+        case TOKEN_AND: case TOKEN_OR: case TOKEN_NOT:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Take the value of the operand the frame's operator last asked for, in
+// *value, and build what follows it. Returns 1 with the next operand to
+// build in *operand, or 0 with the operator's value in *value.
+static int resume_operator(Builder *b, BuildFrame *frame, int *value, NodeId *operand) {
+    Ast *ast = b->ast;
+    NodeId node = frame->node;
+    TokenType kind = ast_kind(ast, node);
+    int line = ast->lines[node];
+    int unary = kind == TOKEN_NOT || (kind == TOKEN_MINUS && ast->left[node] == AST_NONE);
+    int index = frame->index++;
+    if (index == 0) {
+        *operand = unary ? ast->right[node] : ast->left[node];
+        return 1;
+    }
+    if (index == 1 && !unary) {
+        frame->left = *value;
+        if (kind == TOKEN_AND || kind == TOKEN_OR) {
+            // The right operand gets a block of its own, as it may not run
+            frame->left = emit(b, binary_ops[kind], *value, -1, line);
+            frame->saved = b->block;
+            b->block = new_block(b->ir, IR_EXPRESSION, frame->saved, frame->left);
+            b->ir->insts[frame->left].body = b->block;
+        }
+        *operand = ast->right[node];
+        return 1;
+    }
+    if (unary) {
+        *value = emit(b, kind == TOKEN_NOT ? IR_NOT : IR_NEG, *value, -1, line);
+    } else if (kind == TOKEN_AND || kind == TOKEN_OR) {
+        b->ir->insts[frame->left].args[1] = *value;
+        b->block = frame->saved;
+        *value = frame->left;
+    } else {
+        *value = emit(b, binary_ops[kind], frame->left, *value, line);
+    }
+    return 0;
+}
+
+// Build an expression. Operators wait in frames on the heap while their
+// operands are built, so nesting depth costs no native stack.
+static int build_expression(Builder *b, NodeId node) {
+    int value = b->ir->undef;
+    int base = b->frame_count;
+    for (;;) {
+        if (has_operands(b->ast, node)) {
+            if (b->frame_count == b->frame_capacity) {
+                b->frames = grow_array(b->frames, &b->frame_capacity, sizeof(BuildFrame));
+            }
+            b->frames[b->frame_count++] = (BuildFrame){.node = node};
+        } else {
+            value = build_leaf(b, node);
+        }
+        for (;;) {
+            if (b->frame_count == base) return value;
+            if (resume_operator(b, &b->frames[b->frame_count - 1], &value, &node)) break;
+            b->frame_count--;
+        }
+    }
+}
+
+// Slots assigned anywhere in a block, nested loops included
+static void collect_assigned(Builder *b, NodeId block, int **slots, int *count, int *capacity) {
+    Ast *ast = b->ast;
+    for (uint32_t i = 0; i < ast_statement_count(ast, block); i++) {
+        NodeId node = ast_statements(ast, block)[i];
+        TokenType kind = ast_kind(ast, node);
+        if (kind == TOKEN_ASSIGN && !b->marks[ast->slots[node]]) {
+            b->marks[ast->slots[node]] = 1;
+            if (*count == *capacity) {
+                *slots = grow_array(*slots, capacity, sizeof(int));
+            }
+            (*slots)[(*count)++] = ast->slots[node];
+        } else if (kind == TOKEN_WHILE) {
+            collect_assigned(b, ast->right[node], slots, count, capacity);
+        } else if (kind == TOKEN_LBRACE) {
+            collect_assigned(b, node, slots, count, capacity);
+        }
+    }
+}
+
+static void build_statements(Builder *b, NodeId block);
+
+static void build_loop(Builder *b, NodeId node) {
+    IrProgram *ir = b->ir;
+    int line = b->ast->lines[node];
+    int parent = b->block;
+    int loop = emit(b, IR_LOOP, -1, -1, line);
+    int phis = new_block(ir, IR_PHIS, parent, loop);
+    int cond = new_block(ir, IR_EXPRESSION, parent, loop);
+    int body = new_block(ir, IR_STATEMENTS, parent, loop);
+    ir->insts[loop].phis = phis;
+    ir->insts[loop].cond = cond;
+    ir->insts[loop].body = body;
+
+    int *slots = NULL, count = 0, capacity = 0;
+    collect_assigned(b, b->ast->right[node], &slots, &count, &capacity);
+    for (int i = 0; i < count; i++) {
+        b->marks[slots[i]] = 0;
+        int phi = new_inst(ir, IR_PHI, phis, line);
+        ir->insts[phi].args[0] = b->current[slots[i]];
+        ir->insts[phi].slot = slots[i];
+        b->current[slots[i]] = phi;
+    }
+
+    b->block = cond;
+    int condition = build_expression(b, b->ast->left[node]);
+    ir->insts[loop].args[0] = condition;
+    b->block = body;
+    build_statements(b, b->ast->right[node]);
+
+    // Close the back edge; after the loop each variable holds its phi value
+    for (int i = 0; i < count; i++) {
+        int phi = ir->blocks[phis].insts[i];
+        ir->insts[phi].args[1] = b->current[slots[i]];
+        b->current[slots[i]] = phi;
+    }
+    b->block = parent;
+    free(slots);
+}
+
+static void build_statement(Builder *b, NodeId node) {
+    Ast *ast = b->ast;
+    int value;
+    switch (ast_kind(ast, node)) {
+        case TOKEN_PRINT:
+            if (ast->left[node] != AST_NONE) {
+                emit(b, IR_PRINT, build_expression(b, ast->left[node]), -1, ast->lines[node]);
+            }
+            break;
+        case TOKEN_ASSIGN:
+            value = build_expression(b, ast->left[node]);
+            if (b->ir->insts[value].slot < 0 && b->ir->insts[value].op != IR_UNDEF) {
+                b->ir->insts[value].slot = ast->slots[node];
+            }
+            b->current[ast->slots[node]] = value;
+            break;
+        case TOKEN_WHILE:
+            build_loop(b, node);
+            break;
+        case TOKEN_LBRACE:
+            build_statements(b, node);
+            break;
+        default:
+            // A bare identifier statement does nothing, as in interpret()
+            if (is_result_expression(ast_kind(ast, node))) {
+                emit(b, IR_RESULT, build_expression(b, node), -1, ast->lines[node]);
+            }
+            break;
+    }
+}
+
+static void build_statements(Builder *b, NodeId block) {
+    for (uint32_t i = 0; i < ast_statement_count(b->ast, block) && !b->failed; i++) {
+        build_statement(b, ast_statements(b->ast, block)[i]);
+    }
+}
+
+IrProgram* ir_build(Ast *ast, Resolution *resolution) {
+    IrProgram *ir = calloc(1, sizeof(IrProgram));
+    if (!ir) {
+        fprintf(stderr, "Out of memory in the SSA pass\n");
+        exit(1);
+    }
+    ir->slot_count = resolution->slot_count;
+    ir->entry = new_block(ir, IR_STATEMENTS, -1, -1);
+    ir->undef = new_inst(ir, IR_UNDEF, -1, 0);
+
+    Builder b = {0};
+    b.ast = ast;
+    b.ir = ir;
+    b.block = ir->entry;
+    b.current = malloc((ir->slot_count + 1) * sizeof(int));
+    b.marks = calloc(ir->slot_count + 1, 1);
+    if (!b.current || !b.marks) {
+        fprintf(stderr, "Out of memory in the SSA pass\n");
+        exit(1);
+    }
+    for (int i = 0; i < ir->slot_count; i++) {
+        b.current[i] = ir->undef;
+    }
+    build_statements(&b, ast->root);
+
+    free(b.marks);
+    free(b.frames);
+    ir->finals = b.current;
+    if (b.failed) {
+        ir_free(ir);
+        return NULL;
+    }
+    return ir;
+}
+
+void ir_free(IrProgram *ir) {
+    if (!ir) return;
+    for (int i = 0; i < ir->block_count; i++) {
+        free(ir->blocks[i].insts);
+    }
+    free(ir->blocks);
+    free(ir->insts);
+    free(ir->finals);
+    free(ir);
+}
+
+// ---------------------------------------------------------------------------
+// Passes
+
+// Copy propagation through the loop header: a phi whose back edge brings
+// back its own value, or its entry value, is just that entry value
+static void simplify_phis(IrProgram *ir) {
+    int changed;
+    do {
+        changed = 0;
+        for (int id = 0; id < ir->inst_count; id++) {
+            IrInst *inst = &ir->insts[id];
+            if (inst->op != IR_PHI || inst->forward >= 0) continue;
+            int entry = resolve_value(ir, inst->args[0]);
+            int back = resolve_value(ir, inst->args[1]);
+            if (back == id || back == entry) {
+                inst->forward = entry;
+                changed = 1;
+            }
+        }
+    } while (changed);
+}
+
+// A check only has to stay where the value may really be undefined: the
+// resolver flags reads by position, SSA knows which definitions reach them
+static void remove_redundant_checks(IrProgram *ir) {
+    unsigned char *maybe_undef = calloc(ir->inst_count, 1);
+    if (!maybe_undef) {
+        fprintf(stderr, "Out of memory in the SSA pass\n");
+        exit(1);
+    }
+    maybe_undef[ir->undef] = 1;
+    int changed;
+    do {
+        changed = 0;
+        for (int id = 0; id < ir->inst_count; id++) {
+            IrInst *inst = &ir->insts[id];
+            if (inst->op != IR_PHI || inst->forward >= 0 || maybe_undef[id]) continue;
+            if (maybe_undef[resolve_value(ir, inst->args[0])] ||
+                maybe_undef[resolve_value(ir, inst->args[1])]) {
+                maybe_undef[id] = 1;
+                changed = 1;
+            }
+        }
+    } while (changed);
+
+    for (int id = 0; id < ir->inst_count; id++) {
+        IrInst *inst = &ir->insts[id];
+        if (inst->op == IR_CHECK && inst->forward < 0) {
+            int value = resolve_value(ir, inst->args[0]);
+            if (!maybe_undef[value]) {
+                inst->forward = value;
+            }
+        }
+    }
+    free(maybe_undef);
+}
+
+// Whether a block lies inside the loop instruction `loop`
+static int block_within(IrProgram *ir, int block, int loop) {
+    for (; block >= 0; block = ir->blocks[block].parent) {
+        if (ir->blocks[block].owner == loop) return 1;
+    }
+    return 0;
+}
+
+typedef struct {
+    int *ids;
+    int count;
+    int capacity;
+} IdList;
+
+static void id_list_push(IdList *list, int id) {
+    if (list->count == list->capacity) {
+        list->ids = grow_array(list->ids, &list->capacity, sizeof(int));
+    }
+    list->ids[list->count++] = id;
+}
+
+// Move invariant instructions of one block of `loop` to `moved`, recursing
+// into short-circuit operands but not into nested loops, which have already
+// given up their own invariants
+static void collect_invariants(IrProgram *ir, int loop, int block, int target, IdList *moved) {
+    IrBlock *b = &ir->blocks[block];
+    int kept = 0;
+    for (int i = 0; i < b->count; i++) {
+        int id = b->insts[i];
+        IrInst *inst = &ir->insts[id];
+        int invariant = inst->forward < 0 && is_pure(inst->op);
+        for (int a = 0; a < 2 && invariant; a++) {
+            int arg = resolve_value(ir, inst->args[a]);
+            if (arg >= 0 && (arg == ir->undef || block_within(ir, ir->insts[arg].block, loop))) {
+                invariant = 0;
+            }
+        }
+        if (invariant) {
+            // Safe to run even if the loop body never would: pure values
+            // cannot fail, so this only risks computing something unused
+            inst->block = target;
+            id_list_push(moved, id);
+            continue;
+        }
+        if ((inst->op == IR_AND || inst->op == IR_OR) && inst->body >= 0) {
+            collect_invariants(ir, loop, inst->body, target, moved);
+            b = &ir->blocks[block];
+        }
+        b->insts[kept++] = id;
+    }
+    b->count = kept;
+}
+
+// Hoist the invariants of `loop`, which sits at `index` of `block`, to just
+// before it. Returns how many instructions were inserted.
+static int hoist_loop(IrProgram *ir, int block, int index, int loop) {
+    IdList moved = {0};
+    collect_invariants(ir, loop, ir->insts[loop].cond, block, &moved);
+    collect_invariants(ir, loop, ir->insts[loop].body, block, &moved);
+    if (moved.count > 0) {
+        IrBlock *b = &ir->blocks[block];
+        while (b->count + moved.count > b->capacity) {
+            b->insts = grow_array(b->insts, &b->capacity, sizeof(int));
+        }
+        memmove(b->insts + index + moved.count, b->insts + index, (b->count - index) * sizeof(int));
+        memcpy(b->insts + index, moved.ids, moved.count * sizeof(int));
+        b->count += moved.count;
+    }
+    free(moved.ids);
+    return moved.count;
+}
+
+// Loop-invariant code motion, innermost loops first so that invariants of
+// nested loops keep moving outwards as far as they can
+static void hoist_invariants(IrProgram *ir, int block) {
+    for (int i = 0; i < ir->blocks[block].count; i++) {
+        int id = ir->blocks[block].insts[i];
+        if (ir->insts[id].op == IR_LOOP) {
+            hoist_invariants(ir, ir->insts[id].body);
+            i += hoist_loop(ir, block, i, id);
+        }
+    }
+}
+
+// Scoped value table for common subexpression elimination. Entries are
+// pushed while walking a block and popped when it is left, so an
+// instruction is only ever replaced by one that dominates it.
+typedef struct {
+    int *heads;      // Bucket -> newest entry, -1 if empty
+    uint32_t mask;
+    int *ids;        // Entry -> instruction
+    int *next;       // Entry -> older entry in the same bucket
+    uint32_t *buckets;
+    int count;
+    int capacity;
+} ValueTable;
+
+static uint32_t hash_inst(IrProgram *ir, IrInst *inst) {
+    uint64_t h = (uint64_t)inst->op * 0x9E3779B97F4A7C15ull;
+    if (inst->op == IR_CONST) {
+        uint64_t bits;
+        memcpy(&bits, &inst->number, sizeof(bits));
+        h ^= (uint64_t)inst->literal + bits * 31 + (uint64_t)(uintptr_t)inst->string * 17;
+    } else {
+        h ^= (uint64_t)(uint32_t)resolve_value(ir, inst->args[0]) * 0xC2B2AE3D27D4EB4Full;
+        h ^= (uint64_t)(uint32_t)resolve_value(ir, inst->args[1]) * 0x165667B19E3779F9ull;
+        if (inst->op == IR_CHECK) h ^= (uint64_t)(uint32_t)inst->slot;
+    }
+    h ^= h >> 29;
+    return (uint32_t)(h * 0xBF58476D1CE4E5B9ull >> 32);
+}
+
+static int same_value(IrProgram *ir, IrInst *a, IrInst *b) {
+    if (a->op != b->op) return 0;
+    if (a->op == IR_CONST) {
+        return a->literal == b->literal && a->string == b->string &&
+               memcmp(&a->number, &b->number, sizeof(double)) == 0;
+    }
+    if (a->op == IR_CHECK && a->slot != b->slot) {
+        return 0; // Checks of different variables report different names
+    }
+    return resolve_value(ir, a->args[0]) == resolve_value(ir, b->args[0]) &&
+           resolve_value(ir, a->args[1]) == resolve_value(ir, b->args[1]);
+}
+
+static void eliminate_in_block(IrProgram *ir, ValueTable *table, int block) {
+    int mark = table->count;
+    for (int i = 0; i < ir->blocks[block].count; i++) {
+        int id = ir->blocks[block].insts[i];
+        IrInst *inst = &ir->insts[id];
+        if (inst->forward >= 0) continue;
+        switch (inst->op) {
+            case IR_LOOP:
+                eliminate_in_block(ir, table, inst->cond);
+                eliminate_in_block(ir, table, inst->body);
+                continue;
+            case IR_AND:
+            case IR_OR:
+                eliminate_in_block(ir, table, inst->body);
+                continue;
+            default:
+                if (!is_pure(inst->op) && inst->op != IR_CHECK) continue;
+                break;
+        }
+        uint32_t bucket = hash_inst(ir, inst) & table->mask;
+        int found = -1;
+        for (int e = table->heads[bucket]; e >= 0; e = table->next[e]) {
+            if (same_value(ir, &ir->insts[table->ids[e]], inst)) {
+                found = table->ids[e];
+                break;
+            }
+        }
+        if (found >= 0) {
+            inst->forward = found;
+            continue;
+        }
+        if (table->count == table->capacity) {
+            int capacity = table->capacity;
+            table->ids = grow_array(table->ids, &capacity, sizeof(int));
+            capacity = table->capacity;
+            table->next = grow_array(table->next, &capacity, sizeof(int));
+            capacity = table->capacity;
+            table->buckets = grow_array(table->buckets, &capacity, sizeof(uint32_t));
+            table->capacity = capacity;
+        }
+        table->ids[table->count] = id;
+        table->next[table->count] = table->heads[bucket];
+        table->buckets[table->count] = bucket;
+        table->heads[bucket] = table->count++;
+    }
+    // Leaving the block: its values no longer dominate what follows
+    while (table->count > mark) {
+        table->count--;
+        table->heads[table->buckets[table->count]] = table->next[table->count];
+    }
+}
+
+static void eliminate_common_subexpressions(IrProgram *ir) {
+    ValueTable table = {0};
+    uint32_t size = 64;
+    while (size < (uint32_t)ir->inst_count * 2) size *= 2;
+    table.mask = size - 1;
+    table.heads = malloc(size * sizeof(int));
+    if (!table.heads) {
+        fprintf(stderr, "Out of memory in the SSA pass\n");
+        exit(1);
+    }
+    memset(table.heads, 0xff, size * sizeof(int));
+    eliminate_in_block(ir, &table, ir->entry);
+    free(table.heads);
+    free(table.ids);
+    free(table.next);
+    free(table.buckets);
+}
+
+// Mark everything that printing, checks, loops or the variables' final
+// values depend on. A value nothing depends on is a dead store.
+static void mark_live(IrProgram *ir) {
+    IdList work = {0};
+    for (int id = 0; id < ir->inst_count; id++) {
+        IrInst *inst = &ir->insts[id];
+        inst->live = 0;
+        if (inst->forward < 0 && (inst->op == IR_PRINT || inst->op == IR_RESULT ||
+                                  inst->op == IR_CHECK || inst->op == IR_LOOP)) {
+            id_list_push(&work, id);
+        }
+    }
+    for (int slot = 0; slot < ir->slot_count; slot++) {
+        id_list_push(&work, resolve_value(ir, ir->finals[slot]));
+    }
+    while (work.count > 0) {
+        int id = work.ids[--work.count];
+        IrInst *inst = &ir->insts[id];
+        if (inst->live) continue;
+        inst->live = 1;
+        for (int a = 0; a < 2; a++) {
+            if (inst->args[a] >= 0) {
+                id_list_push(&work, resolve_value(ir, inst->args[a]));
+            }
+        }
+        // A check inside a short-circuit operand keeps the operator alive
+        if (inst->block >= 0 && ir->blocks[inst->block].owner >= 0) {
+            id_list_push(&work, ir->blocks[inst->block].owner);
+        }
+    }
+    free(work.ids);
+}
+
+static void compact_blocks(IrProgram *ir) {
+    for (int b = 0; b < ir->block_count; b++) {
+        IrBlock *block = &ir->blocks[b];
+        int kept = 0;
+        for (int i = 0; i < block->count; i++) {
+            IrInst *inst = &ir->insts[block->insts[i]];
+            if (inst->forward < 0 && inst->live) {
+                block->insts[kept++] = block->insts[i];
+            }
+        }
+        block->count = kept;
+    }
+    for (int id = 0; id < ir->inst_count; id++) {
+        IrInst *inst = &ir->insts[id];
+        for (int a = 0; a < 2; a++) {
+            inst->args[a] = resolve_value(ir, inst->args[a]);
+        }
+    }
+    for (int slot = 0; slot < ir->slot_count; slot++) {
+        ir->finals[slot] = resolve_value(ir, ir->finals[slot]);
+    }
+}
+
+void ir_optimize(IrProgram *ir) {
+    simplify_phis(ir);
+    remove_redundant_checks(ir);
+    hoist_invariants(ir, ir->entry);
+    eliminate_common_subexpressions(ir);
+    simplify_phis(ir);
+    remove_redundant_checks(ir);
+    mark_live(ir);
+    compact_blocks(ir);
+}
+
+// ---------------------------------------------------------------------------
+// Lowering. Each standing value is either inlined into the one expression
+// tree that uses it or stored to a slot (its "home") where it is defined.
+// Phis live in slots, assigned on loop entry and at the end of each pass.
+
+enum { USE_NONE, USE_NORMAL, USE_ENTRY, USE_BACK, USE_FINAL };
+
+// An operation waiting for its operands' trees: index counts those lowered
+// and left holds the first one
+typedef struct {
+    int id;
+    int index;
+    NodeId left;
+} LowerFrame;
+
+typedef struct {
+    IrProgram *ir;
+    Resolution *resolution;
+    Ast *ast;
+    int *uses;
+    int *user;          // Inst -> its user if it has exactly one
+    unsigned char *use_kind;
+    int *home;          // Inst -> slot holding it, -1 if inlined
+    unsigned char *inlined;
+    int *position;      // Inst -> index in its block
+    int names_capacity;
+    int scratch;        // Slot that stand-alone checks assign to, -1 until needed
+    int failed;
+    LowerFrame *frames; // Operations of the tree being lowered
+    int frame_count;
+    int frame_capacity;
+    NodeId *pending;    // Nodes tree_reads() has still to visit
+    int pending_count;
+    int pending_capacity;
+} Lowerer;
+
+static int new_slot(Lowerer *l, int variable) {
+    Resolution *res = l->resolution;
+    if (res->slot_count == l->names_capacity) {
+        res->names = grow_array(res->names, &l->names_capacity, sizeof(char*));
+    }
+    res->names[res->slot_count] = variable >= 0 ? res->names[variable] : "tmp";
+    return res->slot_count++;
+}
+
+// The statement block in which a use is evaluated. Short-circuit operands
+// belong to the statement around them; a loop condition counts as its own
+// block because it runs on every pass.
+static int use_block(Lowerer *l, int user, int kind) {
+    IrProgram *ir = l->ir;
+    if (kind == USE_FINAL) {
+        return ir->entry;
+    }
+    IrInst *inst = &ir->insts[user];
+    if (kind == USE_ENTRY) {
+        return ir->blocks[inst->block].parent;
+    }
+    if (kind == USE_BACK) {
+        return ir->insts[ir->blocks[inst->block].owner].body;
+    }
+    if (inst->op == IR_LOOP) {
+        return inst->cond;
+    }
+    int block = inst->block;
+    while (ir->blocks[block].kind == IR_EXPRESSION) {
+        int owner = ir->blocks[block].owner;
+        if (ir->insts[owner].op == IR_LOOP) break;
+        block = ir->insts[owner].block;
+    }
+    return block;
+}
+
+static void add_use(Lowerer *l, int value, int user, int kind) {
+    if (value < 0) return;
+    if (l->uses[value]++ == 0) {
+        l->user[value] = user;
+        l->use_kind[value] = (unsigned char)kind;
+    }
+}
+
+static void count_uses(Lowerer *l, int block) {
+    IrProgram *ir = l->ir;
+    IrBlock *b = &ir->blocks[block];
+    for (int i = 0; i < b->count; i++) {
+        int id = b->insts[i];
+        IrInst *inst = &ir->insts[id];
+        l->position[id] = i;
+        if (inst->op == IR_PHI) {
+            add_use(l, inst->args[0], id, USE_ENTRY);
+            add_use(l, inst->args[1], id, USE_BACK);
+        } else {
+            add_use(l, inst->args[0], id, USE_NORMAL);
+            add_use(l, inst->args[1], id, USE_NORMAL);
+        }
+        if (inst->phis >= 0) count_uses(l, inst->phis);
+        if (inst->cond >= 0) count_uses(l, inst->cond);
+        if (inst->body >= 0) count_uses(l, inst->body);
+    }
+}
+
+// Whether anything that can print or fail runs between two positions of a
+// statement block; moving a check across it would reorder visible effects
+static int effects_between(Lowerer *l, int block, int from, int to) {
+    IrBlock *b = &l->ir->blocks[block];
+    for (int i = from + 1; i < to && i < b->count; i++) {
+        switch (l->ir->insts[b->insts[i]].op) {
+            case IR_PRINT: case IR_RESULT: case IR_LOOP: case IR_CHECK: case IR_AND: case IR_OR:
+                return 1;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+// Position in `block` at which the tree containing `id` is emitted
+static int emission_position(Lowerer *l, int id, int block) {
+    while (l->inlined[id] && l->use_kind[id] == USE_NORMAL) {
+        id = l->user[id];
+        if (l->ir->insts[id].op == IR_LOOP) break;
+    }
+    if (l->inlined[id] && l->use_kind[id] != USE_NORMAL) {
+        return l->ir->blocks[block].count; // Copies follow every statement
+    }
+    return l->position[id];
+}
+
+static void place_values(Lowerer *l, int block) {
+    IrProgram *ir = l->ir;
+    IrBlock *b = &ir->blocks[block];
+    for (int i = 0; i < b->count; i++) {
+        int id = b->insts[i];
+        IrInst *inst = &ir->insts[id];
+        int statement_block = ir->blocks[block].kind == IR_STATEMENTS;
+        if (inst->op == IR_CONST || (!statement_block && inst->op != IR_PHI)) {
+            l->inlined[id] = 1;
+        } else if (is_pure(inst->op) || inst->op == IR_AND || inst->op == IR_OR) {
+            l->inlined[id] = l->uses[id] == 1 && use_block(l, l->user[id], l->use_kind[id]) == block;
+        }
+        if (inst->phis >= 0) place_values(l, inst->phis);
+        if (inst->cond >= 0) place_values(l, inst->cond);
+        if (inst->body >= 0) place_values(l, inst->body);
+    }
+    // Checks move into their user only if no visible effect is skipped
+    for (int i = 0; i < b->count && ir->blocks[block].kind == IR_STATEMENTS; i++) {
+        int id = b->insts[i];
+        if (ir->insts[id].op != IR_CHECK || l->uses[id] != 1 || l->use_kind[id] != USE_NORMAL) continue;
+        if (use_block(l, l->user[id], USE_NORMAL) != block) continue;
+        int at = emission_position(l, l->user[id], block);
+        l->inlined[id] = !effects_between(l, block, i, at);
+    }
+}
+
+static void assign_homes(Lowerer *l) {
+    IrProgram *ir = l->ir;
+    // A variable's final value can live in the variable's own slot: nothing
+    // else is ever stored there
+    for (int slot = 0; slot < ir->slot_count; slot++) {
+        int value = ir->finals[slot];
+        IrOp op = ir->insts[value].op;
+        if (l->home[value] < 0 && !l->inlined[value] &&
+            (op == IR_PHI || is_pure(op) || op == IR_AND || op == IR_OR)) {
+            l->home[value] = slot;
+        }
+    }
+    for (int id = 0; id < ir->inst_count; id++) {
+        IrInst *inst = &ir->insts[id];
+        if (!inst->live || inst->forward >= 0 || l->inlined[id] || l->home[id] >= 0) continue;
+        if (inst->op == IR_PHI || is_pure(inst->op) || inst->op == IR_AND || inst->op == IR_OR) {
+            l->home[id] = new_slot(l, inst->slot);
+        }
+    }
+}
+
+static NodeId identifier_node(Lowerer *l, int slot, int flags, int line) {
+    NodeId node = ast_add_named(l->ast, TOKEN_IDENTIFIER, l->resolution->names[slot], AST_NONE, line);
+    l->ast->slots[node] = slot;
+    l->ast->flags[node] = (uint8_t)flags;
+    return node;
+}
+
+static NodeId assign_node(Lowerer *l, int slot, NodeId value, int line) {
+    NodeId node = ast_add_named(l->ast, TOKEN_ASSIGN, l->resolution->names[slot], value, line);
+    l->ast->slots[node] = slot;
+    return node;
+}
+
+// Slot a check reads: its phi's home, or the variable itself while unassigned
+static int checked_slot(Lowerer *l, int id) {
+    IrInst *inst = &l->ir->insts[id];
+    if (inst->args[0] == l->ir->undef) {
+        return inst->slot;
+    }
+    if (l->home[inst->args[0]] < 0) {
+        l->failed = 1;
+        return inst->slot;
+    }
+    return l->home[inst->args[0]];
+}
+
+static const TokenType node_types[] = {
+    [IR_ADD] = TOKEN_PLUS, [IR_SUB] = TOKEN_MINUS, [IR_MUL] = TOKEN_MUL, [IR_DIV] = TOKEN_DIV,
+    [IR_NEG] = TOKEN_MINUS, [IR_NOT] = TOKEN_NOT, [IR_EQ] = TOKEN_EQ, [IR_NEQ] = TOKEN_NEQ,
+    [IR_LT] = TOKEN_LT, [IR_GT] = TOKEN_GT, [IR_LTE] = TOKEN_LTE, [IR_GTE] = TOKEN_GTE,
+    [IR_AND] = TOKEN_AND, [IR_OR] = TOKEN_OR,
+};
+
+// The node reading a value where it is used, if that takes no operands:
+// checks and values with a home read a slot. Returns AST_NONE when the
+// value's operation has to be rebuilt instead.
+static NodeId lower_read(Lowerer *l, int id) {
+    IrInst *inst = &l->ir->insts[id];
+    if (inst->op == IR_CHECK) {
+        return identifier_node(l, checked_slot(l, id), l->inlined[id] ? AST_CHECK_DEFINED : 0, inst->line);
+    }
+    if (l->home[id] >= 0) {
+        return identifier_node(l, l->home[id], 0, inst->line);
+    }
+    if (inst->op == IR_UNDEF || inst->op == IR_PHI) {
+        l->failed = 1;
+    }
+    return AST_NONE;
+}
+
+// The node for an operation without operands
+static NodeId lower_leaf(Lowerer *l, int id) {
+    IrInst *inst = &l->ir->insts[id];
+    if (inst->op != IR_CONST) {
+        l->failed = 1;
+        return ast_add_number(l->ast, 0, inst->line);
+    }
+    if (inst->literal == TOKEN_NUMBER) {
+        return ast_add_number(l->ast, inst->number, inst->line);
+    }
+    if (inst->literal == TOKEN_STRING) {
+        return ast_add_named(l->ast, TOKEN_STRING, inst->string, AST_NONE, inst->line);
+    }
+    return ast_add_node(l->ast, inst->literal, AST_NONE, AST_NONE, inst->line);
+}
+
+// Rebuild the tree computing an instruction; the root ignores any home it
+// has when `operation` is set. Operations wait in frames on the heap while
+// their operands are lowered, so nesting depth costs no native stack.
+static NodeId lower_expression(Lowerer *l, int id, int operation) {
+    NodeId node = AST_NONE;
+    int base = l->frame_count;
+    for (;;) {
+        IrInst *inst = &l->ir->insts[id];
+        NodeId read = operation ? AST_NONE : lower_read(l, id);
+        operation = 0;
+        if (read != AST_NONE) {
+            node = read;
+        } else if ((inst->op >= IR_ADD && inst->op <= IR_GTE) || inst->op == IR_NEG || inst->op == IR_NOT ||
+                   inst->op == IR_AND || inst->op == IR_OR) {
+            if (l->frame_count == l->frame_capacity) {
+                l->frames = grow_array(l->frames, &l->frame_capacity, sizeof(LowerFrame));
+            }
+            l->frames[l->frame_count++] = (LowerFrame){id, 0, AST_NONE};
+        } else {
+            node = lower_leaf(l, id);
+        }
+        // Complete operations until one has another operand to lower
+        for (;;) {
+            if (l->frame_count == base) return node;
+            LowerFrame *frame = &l->frames[l->frame_count - 1];
+            IrInst *op = &l->ir->insts[frame->id];
+            int unary = op->op == IR_NEG || op->op == IR_NOT;
+            if (frame->index < (unary ? 1 : 2)) {
+                if (frame->index++ == 1) frame->left = node;
+                id = op->args[frame->index - 1];
+                break;
+            }
+            node = unary ? ast_add_node(l->ast, node_types[op->op], AST_NONE, node, op->line)
+                         : ast_add_node(l->ast, node_types[op->op], frame->left, node, op->line);
+            l->frame_count--;
+        }
+    }
+}
+
+// The expression computing an instruction, ignoring any home it has
+static NodeId lower_operation(Lowerer *l, int id) {
+    return lower_expression(l, id, 1);
+}
+
+// The expression reading a value where it is used
+static NodeId lower_tree(Lowerer *l, int id) {
+    return lower_expression(l, id, 0);
+}
+
+// Statements of a block being lowered, turned into an AST block when complete
+typedef struct {
+    NodeId *items;
+    int count;
+    int capacity;
+} StatementList;
+
+static void append_statement(StatementList *list, NodeId node) {
+    if (list->count == list->capacity) {
+        list->items = grow_array(list->items, &list->capacity, sizeof(NodeId));
+    }
+    list->items[list->count++] = node;
+}
+
+// Whether an expression tree reads a slot
+static int tree_reads(Lowerer *l, NodeId node, int slot) {
+    Ast *ast = l->ast;
+    l->pending_count = 0;
+    for (;;) {
+        if (node != AST_NONE) {
+            if (ast_kind(ast, node) == TOKEN_IDENTIFIER) {
+                if (ast->slots[node] == slot) return 1;
+            } else {
+                if (l->pending_count == l->pending_capacity) {
+                    l->pending = grow_array(l->pending, &l->pending_capacity, sizeof(NodeId));
+                }
+                l->pending[l->pending_count++] = ast->right[node];
+                node = ast->left[node];
+                continue;
+            }
+        }
+        if (l->pending_count == 0) return 0;
+        node = l->pending[--l->pending_count];
+    }
+}
+
+// Assign each loop phi its back-edge value. The copies happen in parallel,
+// so order them to never overwrite a phi another copy still has to read,
+// and break cycles through a temporary.
+static void lower_back_edge(Lowerer *l, int loop, StatementList *list) {
+    IrProgram *ir = l->ir;
+    IrBlock *phis = &ir->blocks[ir->insts[loop].phis];
+    int count = 0;
+    int *targets = malloc((phis->count + 1) * sizeof(int));
+    NodeId *values = malloc((phis->count + 1) * sizeof(NodeId));
+    if (!targets || !values) {
+        fprintf(stderr, "Out of memory in the SSA pass\n");
+        exit(1);
+    }
+    for (int i = 0; i < phis->count; i++) {
+        int phi = phis->insts[i];
+        int back = ir->insts[phi].args[1];
+        if (back == phi || l->home[back] == l->home[phi]) continue;
+        targets[count] = l->home[phi];
+        values[count++] = lower_tree(l, back);
+    }
+    while (count > 0) {
+        int ready = -1;
+        for (int i = 0; i < count && ready < 0; i++) {
+            ready = i;
+            for (int j = 0; j < count; j++) {
+                if (j != i && tree_reads(l, values[j], targets[i])) {
+                    ready = -1;
+                    break;
+                }
+            }
+        }
+        if (ready < 0) {
+            // Every pending phi is still read by another copy: park one
+            // value that reads a phi in a temporary
+            int parked = 0;
+            for (int i = 0; i < count; i++) {
+                for (int j = 0; j < count; j++) {
+                    if (j != i && tree_reads(l, values[i], targets[j])) parked = i;
+                }
+            }
+            int slot = new_slot(l, -1);
+            append_statement(list, assign_node(l, slot, values[parked], ir->insts[loop].line));
+            values[parked] = identifier_node(l, slot, 0, ir->insts[loop].line);
+            continue;
+        }
+        append_statement(list, assign_node(l, targets[ready], values[ready], ir->insts[loop].line));
+        targets[ready] = targets[count - 1];
+        values[ready] = values[count - 1];
+        count--;
+    }
+    free(targets);
+    free(values);
+}
+
+static int inside_loop(IrProgram *ir, int block) {
+    for (; block >= 0; block = ir->blocks[block].parent) {
+        if (ir->blocks[block].owner >= 0 && ir->insts[ir->blocks[block].owner].op == IR_LOOP) return 1;
+    }
+    return 0;
+}
+
+static void lower_block(Lowerer *l, int block, StatementList *list);
+
+static NodeId lower_loop(Lowerer *l, int loop, StatementList *list) {
+    IrProgram *ir = l->ir;
+    IrInst *inst = &ir->insts[loop];
+    IrBlock *phis = &ir->blocks[inst->phis];
+    for (int i = 0; i < phis->count; i++) {
+        int phi = phis->insts[i];
+        int entry = ir->insts[phi].args[0];
+        if (entry == ir->undef) {
+            // Fresh slots start out undefined, but only a loop that is
+            // entered once can rely on that
+            if (inside_loop(ir, ir->blocks[inst->phis].parent)) l->failed = 1;
+            continue;
+        }
+        if (l->home[entry] != l->home[phi]) {
+            append_statement(list, assign_node(l, l->home[phi], lower_tree(l, entry), inst->line));
+        }
+    }
+
+    NodeId condition = lower_tree(l, inst->args[0]);
+    StatementList body = {0};
+    lower_block(l, inst->body, &body);
+    lower_back_edge(l, loop, &body);
+    NodeId block = ast_add_block(l->ast, body.items, (uint32_t)body.count, inst->line);
+    free(body.items);
+    return ast_add_node(l->ast, TOKEN_WHILE, condition, block, inst->line);
+}
+
+static void lower_block(Lowerer *l, int block, StatementList *list) {
+    IrProgram *ir = l->ir;
+    for (int i = 0; i < ir->blocks[block].count; i++) {
+        int id = ir->blocks[block].insts[i];
+        IrInst *inst = &ir->insts[id];
+        NodeId node;
+        switch (inst->op) {
+            case IR_CONST:
+            case IR_UNDEF:
+            case IR_PHI:
+                break;
+            case IR_CHECK:
+                if (!l->inlined[id]) {
+                    if (l->scratch < 0) l->scratch = new_slot(l, -1);
+                    node = identifier_node(l, checked_slot(l, id), AST_CHECK_DEFINED, inst->line);
+                    append_statement(list, assign_node(l, l->scratch, node, inst->line));
+                }
+                break;
+            case IR_PRINT:
+                node = lower_tree(l, inst->args[0]);
+                append_statement(list, ast_add_node(l->ast, TOKEN_PRINT, node, AST_NONE, inst->line));
+                break;
+            case IR_RESULT:
+                // Only operators and literals are echoed, so rebuild the
+                // expression even if its value is already in a slot
+                node = lower_operation(l, inst->args[0]);
+                if (!is_result_expression(ast_kind(l->ast, node))) l->failed = 1;
+                append_statement(list, node);
+                break;
+            case IR_LOOP:
+                node = lower_loop(l, id, list);
+                append_statement(list, node);
+                break;
+            default:
+                if (!l->inlined[id]) {
+                    append_statement(list, assign_node(l, l->home[id], lower_operation(l, id), inst->line));
+                }
+                break;
+        }
+    }
+}
+
+int ir_lower(IrProgram *ir, Resolution *resolution, Ast *ast) {
+    Lowerer l = {0};
+    l.ir = ir;
+    l.resolution = resolution;
+    l.ast = ast;
+    l.names_capacity = resolution->slot_count;
+    l.scratch = -1;
+    size_t count = (size_t)ir->inst_count;
+    l.uses = calloc(count, sizeof(int));
+    l.user = calloc(count, sizeof(int));
+    l.use_kind = calloc(count, 1);
+    l.home = malloc(count * sizeof(int));
+    l.inlined = calloc(count, 1);
+    l.position = calloc(count, sizeof(int));
+    if (!l.uses || !l.user || !l.use_kind || !l.home || !l.inlined || !l.position) {
+        fprintf(stderr, "Out of memory in the SSA pass\n");
+        exit(1);
+    }
+    memset(l.home, 0xff, count * sizeof(int));
+
+    count_uses(&l, ir->entry);
+    for (int slot = 0; slot < ir->slot_count; slot++) {
+        add_use(&l, ir->finals[slot], -1, USE_FINAL);
+    }
+    place_values(&l, ir->entry);
+    assign_homes(&l);
+
+    StatementList list = {0};
+    lower_block(&l, ir->entry, &list);
+    for (int slot = 0; slot < ir->slot_count; slot++) {
+        int value = ir->finals[slot];
+        if (value != ir->undef && l.home[value] != slot) {
+            append_statement(&list, assign_node(&l, slot, lower_tree(&l, value), ir->insts[value].line));
+        }
+    }
+    // The old statements stay in the arrays but are no longer reachable
+    if (!l.failed) {
+        ast->root = ast_add_block(ast, list.items, (uint32_t)list.count, ast->lines[ast->root]);
+    }
+
+    free(list.items);
+    free(l.uses);
+    free(l.user);
+    free(l.use_kind);
+    free(l.home);
+    free(l.inlined);
+    free(l.position);
+    free(l.frames);
+    free(l.pending);
+    return !l.failed;
+}
+
+// ---------------------------------------------------------------------------
+// Utility function to print the IR
+
+static const char *op_names[] = {
+    "const", "undef", "phi", "check", "add", "sub", "mul", "div", "neg", "not",
+    "eq", "neq", "lt", "gt", "lte", "gte", "and", "or", "print", "result", "loop"
+};
+
+static void print_block(IrProgram *ir, Resolution *resolution, int block, int depth) {
+    for (int i = 0; i < ir->blocks[block].count; i++) {
+        int id = ir->blocks[block].insts[i];
+        IrInst *inst = &ir->insts[id];
+        for (int d = 0; d < depth; d++) printf("  ");
+        if (inst->op == IR_PRINT || inst->op == IR_RESULT || inst->op == IR_LOOP) {
+            printf("%s", op_names[inst->op]);
+        } else {
+            printf("%%%d = %s", id, op_names[inst->op]);
+        }
+        if (inst->op == IR_CONST) {
+            if (inst->literal == TOKEN_STRING) {
+                printf(" \"%s\"", inst->string);
+            } else if (inst->literal == TOKEN_NUMBER) {
+                printf(" %g", inst->number);
+            } else {
+                printf(" %s", inst->literal == TOKEN_TRUE ? "true" : "false");
+            }
+        }
+        for (int a = 0; a < 2; a++) {
+            if (inst->args[a] >= 0) printf("%s %%%d", a ? "," : "", inst->args[a]);
+        }
+        if ((inst->op == IR_PHI || inst->op == IR_CHECK) && inst->slot >= 0) {
+            printf(" (%s)", resolution->names[inst->slot]);
+        }
+        printf("\n");
+        if (inst->op == IR_LOOP) {
+            for (int d = 0; d < depth; d++) printf("  ");
+            printf(" header:\n");
+            print_block(ir, resolution, inst->phis, depth + 1);
+            for (int d = 0; d < depth; d++) printf("  ");
+            printf(" condition:\n");
+            print_block(ir, resolution, inst->cond, depth + 1);
+            for (int d = 0; d < depth; d++) printf("  ");
+            printf(" body:\n");
+            print_block(ir, resolution, inst->body, depth + 1);
+        } else if (inst->body >= 0) {
+            print_block(ir, resolution, inst->body, depth + 1);
+        }
+    }
+}
+
+void ir_print(IrProgram *ir, Resolution *resolution) {
+    print_block(ir, resolution, ir->entry, 0);
+}
@@ -0,0 +1,103 @@
+#ifndef IR_H
+#define IR_H
+
+#include "parser.h"
+#include "resolver.h"
+
+// SSA intermediate representation of a resolved program. Every instruction
+// defines at most one value and variables disappear: an assignment just
+// makes the variable name a different value. Control flow stays structured,
+// so a block is a plain instruction list and nesting is recorded through
+// the instruction that owns each block.
+typedef enum {
+    IR_CONST,    // Literal number, string or boolean
+    IR_UNDEF,    // Contents of a variable before its first assignment
+    IR_PHI,      // Loop-carried variable: args[0] on entry, args[1] from the back edge
+    IR_CHECK,    // args[0], failing at run time if it is still undefined
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_NEG,
+    IR_NOT,
+    IR_EQ,
+    IR_NEQ,
+    IR_LT,
+    IR_GT,
+    IR_LTE,
+    IR_GTE,
+    IR_AND,      // args[0] && args[1]; args[1] is computed in `body` only when needed
+    IR_OR,       // args[0] || args[1]; likewise
+    IR_PRINT,    // Prints args[0]
+    IR_RESULT,   // Echoes args[0] as "Result: ..."
+    IR_LOOP      // while (args[0]) body; `phis`, `cond` and `body` are its blocks
+} IrOp;
+
+typedef enum {
+    IR_STATEMENTS, // Program or loop body: values may be stored to slots here
+    IR_EXPRESSION, // Loop condition or short-circuit operand, emitted as one tree
+    IR_PHIS        // Loop header
+} IrBlockKind;
+
+typedef struct {
+    IrOp op;
+    int args[2];     // Operand instruction ids, -1 if unused
+    int block;       // Block the instruction is placed in, -1 for IR_UNDEF
+    int slot;        // PHI/CHECK: the variable; otherwise the variable first
+                     // assigned this value (used for naming), or -1
+    int line;
+    int forward;     // Instruction this one was replaced by, -1 if it stands
+    int live;
+
+    TokenType literal; // IR_CONST: TOKEN_NUMBER, TOKEN_STRING, TOKEN_TRUE or TOKEN_FALSE
+    double number;
+    char *string;
+
+    int phis, cond, body; // Owned blocks, -1 if none
+} IrInst;
+
+typedef struct {
+    IrBlockKind kind;
+    int parent;      // Enclosing block, -1 for the program
+    int owner;       // Instruction owning the block, -1 for the program
+    int *insts;
+    int count;
+    int capacity;
+} IrBlock;
+
+typedef struct {
+    IrInst *insts;
+    int inst_count;
+    int inst_capacity;
+
+    IrBlock *blocks;
+    int block_count;
+    int block_capacity;
+
+    int entry;       // Top-level block
+    int undef;       // The single IR_UNDEF instruction
+    int *finals;     // Variable slot -> value it holds when the program ends
+    int slot_count;
+} IrProgram;
+
+// Build the IR of a resolved program. Returns NULL if the program uses a
+// construct the IR cannot represent.
+IrProgram* ir_build(Ast *ast, Resolution *resolution);
+
+// Copy propagation through loop phis, removal of provably redundant
+// definedness checks, loop-invariant code motion, common subexpression
+// elimination and dead code elimination, which also removes stores to
+// variables that are reassigned before being read.
+void ir_optimize(IrProgram *ir);
+
+// Lower the IR back to a program both executors can run. Values that must
+// outlive the statement computing them get slots of their own, which are
+// added to `resolution`; every variable still holds its final value when
+// the program ends. The new statements are added to `ast` and replace its
+// root; returns 0 and leaves the root alone if lowering failed.
+int ir_lower(IrProgram *ir, Resolution *resolution, Ast *ast);
+
+void ir_print(IrProgram *ir, Resolution *resolution);
+void ir_free(IrProgram *ir);
+
+#endif // IR_H
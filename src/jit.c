@@ -0,0 +1,480 @@
+#include "jit.h"
+#include "trace.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+// Variables live in xmm0 upwards; the registers above them hold temporaries
+#define JIT_REGISTERS 16
+#define JIT_MAX_VARIABLES 12
+
+// Compiled loop: takes the variables in register order, leaves the values
+// they end with in the same array and returns the number of iterations run
+typedef uint64_t (*LoopCode)(double *variables);
+
+typedef enum {
+    LOOP_COUNTING,
+    LOOP_COMPILED,
+    LOOP_REJECTED  // Not compilable; never looked at again
+} LoopState;
+
+typedef struct {
+    LoopState state;
+    uint32_t iterations;         // Run by the tree walker before compiling
+    LoopCode code;
+    size_t code_size;
+    int count;                   // Variables used by the loop
+    int slots[JIT_MAX_VARIABLES];
+    uint8_t live_in[JIT_MAX_VARIABLES];  // Read before any assignment to it
+    uint8_t assigned[JIT_MAX_VARIABLES];
+} JitLoop;
+
+struct Jit {
+    JitLoop **loops; // Indexed by the while node
+    uint32_t loop_capacity;
+};
+
+// Machine code being assembled
+typedef struct {
+    Ast *ast;
+    JitLoop *loop;
+    uint8_t *bytes;
+    size_t count;
+    size_t capacity;
+    int failed;
+} Assembler;
+
+Jit* jit_create(Ast *ast) {
+    Jit *jit = malloc(sizeof(Jit));
+    if (jit) {
+        jit->loop_capacity = ast->count;
+        jit->loops = calloc(jit->loop_capacity + 1, sizeof(JitLoop*));
+    }
+    if (!jit || !jit->loops) {
+        fprintf(stderr, "Out of memory while starting the JIT\n");
+        exit(1);
+    }
+    return jit;
+}
+
+void jit_free(Jit *jit) {
+    if (!jit) return;
+    for (uint32_t i = 0; i < jit->loop_capacity; i++) {
+        JitLoop *loop = jit->loops[i];
+        if (loop) {
+#ifdef JIT_SUPPORTED
+            if (loop->code) {
+                munmap((void*)loop->code, loop->code_size);
+            }
+#endif
+            free(loop);
+        }
+    }
+    free(jit->loops);
+    free(jit);
+}
+
+// Register holding a variable, adding the variable if it is new. Returns -1
+// once the loop uses more variables than fit.
+static int variable_register(JitLoop *loop, int slot) {
+    for (int i = 0; i < loop->count; i++) {
+        if (loop->slots[i] == slot) return i;
+    }
+    if (loop->count == JIT_MAX_VARIABLES) {
+        return -1;
+    }
+    loop->slots[loop->count] = slot;
+    loop->live_in[loop->count] = 0;
+    loop->assigned[loop->count] = 0;
+    return loop->count++;
+}
+
+// Check that an expression is arithmetic the templates cover, registering
+// its variables. Statements are walked in order, so a variable read before
+// the body assigns it must already hold a number when the loop is entered.
+static int scan_expression(Assembler *a, NodeId node) {
+    Ast *ast = a->ast;
+    int reg;
+    switch (ast_kind(ast, node)) {
+        case TOKEN_NUMBER:
+            return 1;
+        case TOKEN_IDENTIFIER:
+            reg = variable_register(a->loop, ast->slots[node]);
+            if (reg < 0) return 0;
+            if (!a->loop->assigned[reg]) {
+                a->loop->live_in[reg] = 1;
+            }
+            return 1;
+        case TOKEN_MINUS:
+            if (ast->left[node] == AST_NONE) {
+                return scan_expression(a, ast->right[node]);
+            }
+            return scan_expression(a, ast->left[node]) && scan_expression(a, ast->right[node]);
+        case TOKEN_PLUS:
+        case NODE_ADD_NUMBERS:
+        case NODE_GUARDED_ADD_NUMBERS:
+        case TOKEN_MUL:
+        case TOKEN_DIV:
+            return scan_expression(a, ast->left[node]) && scan_expression(a, ast->right[node]);
+        default:
+            return 0;
+    }
+}
+
+static int scan_statements(Assembler *a, NodeId block) {
+    Ast *ast = a->ast;
+    for (uint32_t i = 0; i < ast_statement_count(ast, block); i++) {
+        NodeId node = ast_statements(ast, block)[i];
+        int reg;
+        switch (ast_kind(ast, node)) {
+            case TOKEN_ASSIGN:
+                if (!scan_expression(a, ast->left[node])) return 0;
+                reg = variable_register(a->loop, ast->slots[node]);
+                if (reg < 0) return 0;
+                a->loop->assigned[reg] = 1;
+                break;
+            case TOKEN_LBRACE:
+                if (!scan_statements(a, node)) return 0;
+                break;
+            default:
+                return 0; // Output, nested loops and the like stay interpreted
+        }
+    }
+    return 1;
+}
+
+static void emit_byte(Assembler *a, uint8_t byte) {
+    if (a->count == a->capacity) {
+        a->capacity = a->capacity ? a->capacity * 2 : 256;
+        a->bytes = realloc(a->bytes, a->capacity);
+        if (!a->bytes) {
+            fprintf(stderr, "Out of memory while compiling a loop\n");
+            exit(1);
+        }
+    }
+    a->bytes[a->count++] = byte;
+}
+
+static void emit_u32(Assembler *a, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        emit_byte(a, (uint8_t)(value >> (8 * i)));
+    }
+}
+
+static void patch_u32(Assembler *a, size_t at, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        a->bytes[at + i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+// SSE instruction on two XMM registers: prefix, REX if either register is
+// xmm8 or above, 0F, opcode, ModRM
+static void emit_sse(Assembler *a, uint8_t prefix, uint8_t opcode, int reg, int rm) {
+    emit_byte(a, prefix);
+    if (reg >= 8 || rm >= 8) {
+        emit_byte(a, (uint8_t)(0x40 | ((reg >> 3) << 2) | (rm >> 3)));
+    }
+    emit_byte(a, 0x0F);
+    emit_byte(a, opcode);
+    emit_byte(a, (uint8_t)(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+}
+
+// movsd between an XMM register and [rdi + 8 * index]
+static void emit_variable_access(Assembler *a, uint8_t opcode, int reg, int index) {
+    emit_byte(a, 0xF2);
+    if (reg >= 8) {
+        emit_byte(a, 0x44);
+    }
+    emit_byte(a, 0x0F);
+    emit_byte(a, opcode);
+    emit_byte(a, (uint8_t)(0x87 | ((reg & 7) << 3))); // mod 10, rm = rdi, disp32
+    emit_u32(a, (uint32_t)(8 * index));
+}
+
+// movabs rcx, bits; movq xmm, rcx
+static void emit_constant(Assembler *a, int reg, uint64_t bits) {
+    emit_byte(a, 0x48);
+    emit_byte(a, 0xB9);
+    for (int i = 0; i < 8; i++) {
+        emit_byte(a, (uint8_t)(bits >> (8 * i)));
+    }
+    emit_byte(a, 0x66);
+    emit_byte(a, reg >= 8 ? 0x4C : 0x48);
+    emit_byte(a, 0x0F);
+    emit_byte(a, 0x6E);
+    emit_byte(a, (uint8_t)(0xC1 | ((reg & 7) << 3)));
+}
+
+// Jump with a 32-bit displacement to patch later; returns where it is
+static size_t emit_jump(Assembler *a, uint8_t condition) {
+    if (condition) {
+        emit_byte(a, 0x0F);
+        emit_byte(a, condition);
+    } else {
+        emit_byte(a, 0xE9);
+    }
+    size_t at = a->count;
+    emit_u32(a, 0);
+    return at;
+}
+
+static void patch_jump(Assembler *a, size_t at, size_t target) {
+    patch_u32(a, at, (uint32_t)((int64_t)target - (int64_t)(at + 4)));
+}
+
+#define OP_MOVSD_LOAD  0x10
+#define OP_MOVSD_STORE 0x11
+#define OP_UCOMISD     0x2E
+#define OP_XORPD       0x57
+#define OP_ADDSD       0x58
+#define OP_MULSD       0x59
+#define OP_SUBSD       0x5C
+#define OP_DIVSD       0x5E
+#define JCC_B   0x82
+#define JCC_E   0x84
+#define JCC_NE  0x85
+#define JCC_BE  0x86
+#define JCC_P   0x8A
+
+// Compute an expression into register `reg`, using the ones above it as
+// scratch
+static void emit_expression(Assembler *a, NodeId node, int reg) {
+    Ast *ast = a->ast;
+    uint64_t bits;
+    double number;
+    uint8_t opcode;
+
+    if (reg >= JIT_REGISTERS) {
+        a->failed = 1; // Too deeply nested for the registers left
+        return;
+    }
+    switch (ast_kind(ast, node)) {
+        case TOKEN_NUMBER:
+            number = ast_number(ast, node);
+            memcpy(&bits, &number, sizeof(bits));
+            emit_constant(a, reg, bits);
+            return;
+        case TOKEN_IDENTIFIER:
+            emit_sse(a, 0xF2, OP_MOVSD_LOAD, reg, variable_register(a->loop, ast->slots[node]));
+            return;
+        case TOKEN_MINUS:
+            if (ast->left[node] == AST_NONE) {
+                // Flip the sign bit, as C's unary minus does
+                emit_expression(a, ast->right[node], reg);
+                if (reg + 1 >= JIT_REGISTERS) {
+                    a->failed = 1;
+                    return;
+                }
+                emit_constant(a, reg + 1, (uint64_t)1 << 63);
+                emit_sse(a, 0x66, OP_XORPD, reg, reg + 1);
+                return;
+            }
+            opcode = OP_SUBSD;
+            break;
+        case TOKEN_PLUS:
+        case NODE_ADD_NUMBERS:
+        case NODE_GUARDED_ADD_NUMBERS:
+            opcode = OP_ADDSD;
+            break;
+        case TOKEN_MUL:
+            opcode = OP_MULSD;
+            break;
+        default:
+            opcode = OP_DIVSD;
+            break;
+    }
+    emit_expression(a, ast->left[node], reg);
+    NodeId right = ast->right[node];
+    if (ast_kind(ast, right) == TOKEN_IDENTIFIER) {
+        emit_sse(a, 0xF2, opcode, reg, variable_register(a->loop, ast->slots[right]));
+    } else {
+        emit_expression(a, right, reg + 1);
+        emit_sse(a, 0xF2, opcode, reg, reg + 1);
+    }
+}
+
+static void emit_statements(Assembler *a, NodeId block) {
+    Ast *ast = a->ast;
+    int scratch = a->loop->count;
+    for (uint32_t i = 0; i < ast_statement_count(ast, block); i++) {
+        NodeId node = ast_statements(ast, block)[i];
+        if (ast_kind(ast, node) == TOKEN_LBRACE) {
+            emit_statements(a, node);
+            continue;
+        }
+        // Compute into scratch first: the expression may read the variable
+        emit_expression(a, ast->left[node], scratch);
+        emit_sse(a, 0xF2, OP_MOVSD_LOAD, variable_register(a->loop, ast->slots[node]), scratch);
+    }
+}
+
+// Emit the loop condition as jumps to the exit taken when it is false,
+// returning how many were added to `exits`. Unordered operands (NaN) make
+// every comparison but != false, as in C.
+static int emit_condition(Assembler *a, NodeId condition, size_t *exits) {
+    Ast *ast = a->ast;
+    int left = a->loop->count, right = left + 1;
+    TokenType kind = ast_kind(ast, condition);
+    emit_expression(a, ast->left[condition], left);
+    emit_expression(a, ast->right[condition], right);
+    switch (kind) {
+        case TOKEN_LT:  // right > left
+            emit_sse(a, 0x66, OP_UCOMISD, right, left);
+            exits[0] = emit_jump(a, JCC_BE);
+            return 1;
+        case TOKEN_GT:
+            emit_sse(a, 0x66, OP_UCOMISD, left, right);
+            exits[0] = emit_jump(a, JCC_BE);
+            return 1;
+        case TOKEN_LTE: // right >= left
+            emit_sse(a, 0x66, OP_UCOMISD, right, left);
+            exits[0] = emit_jump(a, JCC_B);
+            return 1;
+        case TOKEN_GTE:
+            emit_sse(a, 0x66, OP_UCOMISD, left, right);
+            exits[0] = emit_jump(a, JCC_B);
+            return 1;
+        case TOKEN_EQ:
+        case NODE_EQ_NUMBERS:
+        case NODE_GUARDED_EQ_NUMBERS:
+            emit_sse(a, 0x66, OP_UCOMISD, left, right);
+            exits[0] = emit_jump(a, JCC_P);
+            exits[1] = emit_jump(a, JCC_NE);
+            return 2;
+        default: // The != kinds: unordered counts as not equal
+            emit_sse(a, 0x66, OP_UCOMISD, left, right);
+            emit_byte(a, 0x7A); // jp over the exit
+            emit_byte(a, 6);
+            exits[0] = emit_jump(a, JCC_E);
+            return 1;
+    }
+}
+
+// Assemble a loop, or return 0 if it is not one the templates cover
+static int assemble_loop(Assembler *a, NodeId node) {
+    Ast *ast = a->ast;
+    JitLoop *loop = a->loop;
+    NodeId condition = ast->left[node];
+    size_t exits[2];
+
+    switch (ast_kind(ast, condition)) {
+        case TOKEN_LT: case TOKEN_GT: case TOKEN_LTE:
+        case TOKEN_GTE: case TOKEN_EQ: case TOKEN_NEQ:
+        case NODE_EQ_NUMBERS: case NODE_NEQ_NUMBERS:
+        case NODE_GUARDED_EQ_NUMBERS: case NODE_GUARDED_NEQ_NUMBERS:
+            break;
+        default:
+            return 0;
+    }
+    if (!scan_expression(a, ast->left[condition]) || !scan_expression(a, ast->right[condition]) ||
+        !scan_statements(a, ast->right[node])) {
+        return 0;
+    }
+
+    for (int i = 0; i < loop->count; i++) {
+        emit_variable_access(a, OP_MOVSD_LOAD, i, i);
+    }
+    emit_byte(a, 0x31); // xor eax, eax: the iteration count
+    emit_byte(a, 0xC0);
+    size_t top = a->count;
+    int exit_count = emit_condition(a, condition, exits);
+    emit_statements(a, ast->right[node]);
+    emit_byte(a, 0x48); // inc rax
+    emit_byte(a, 0xFF);
+    emit_byte(a, 0xC0);
+    patch_jump(a, emit_jump(a, 0), top);
+    for (int i = 0; i < exit_count; i++) {
+        patch_jump(a, exits[i], a->count);
+    }
+    for (int i = 0; i < loop->count; i++) {
+        if (loop->assigned[i]) {
+            emit_variable_access(a, OP_MOVSD_STORE, i, i);
+        }
+    }
+    emit_byte(a, 0xC3); // ret
+    return !a->failed;
+}
+
+// Compile a hot loop into executable memory, or mark it as rejected
+static void compile_loop(Ast *ast, NodeId node, JitLoop *loop) {
+    Assembler a = {ast, loop, NULL, 0, 0, 0};
+    loop->state = LOOP_REJECTED;
+#ifdef JIT_SUPPORTED
+    if (assemble_loop(&a, node)) {
+        // Written while writable, then made executable and read-only
+        void *memory = mmap(NULL, a.count, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory != MAP_FAILED) {
+            memcpy(memory, a.bytes, a.count);
+            if (mprotect(memory, a.count, PROT_READ | PROT_EXEC) == 0) {
+                loop->code = (LoopCode)memory;
+                loop->code_size = a.count;
+                loop->state = LOOP_COMPILED;
+            } else {
+                munmap(memory, a.count);
+            }
+        }
+    }
+#else
+    (void)node;
+    (void)assemble_loop;
+#endif
+    TRACE(TRACE_EVAL, TRACE_INFO, "JIT: loop at line %d %s (%zu bytes, %d variables)",
+          ast->lines[node], loop->state == LOOP_COMPILED ? "compiled" : "rejected", a.count, loop->count);
+    free(a.bytes);
+}
+
+int jit_loop(Jit *jit, Ast *ast, NodeId node, Value *globals) {
+    if (node >= jit->loop_capacity) {
+        return 0; // Added to the tree after the JIT started
+    }
+    JitLoop *loop = jit->loops[node];
+    if (!loop) {
+        loop = calloc(1, sizeof(JitLoop));
+        if (!loop) {
+            fprintf(stderr, "Out of memory while running\n");
+            exit(1);
+        }
+        jit->loops[node] = loop;
+    }
+    if (loop->state == LOOP_COUNTING) {
+        if (++loop->iterations < JIT_HOT_LOOP) {
+            return 0;
+        }
+        compile_loop(ast, node, loop);
+    }
+    if (loop->state != LOOP_COMPILED) {
+        return 0;
+    }
+
+    // Guard: variables the loop reads must be numbers. One it only assigns
+    // may also still be undefined, since it is written before it is read.
+    double variables[JIT_MAX_VARIABLES];
+    for (int i = 0; i < loop->count; i++) {
+        Value value = globals[loop->slots[i]];
+        if (IS_NUMBER(value)) {
+            variables[i] = AS_NUMBER(value);
+        } else if (!loop->live_in[i] && IS_UNDEFINED(value)) {
+            variables[i] = 0;
+        } else {
+            TRACE(TRACE_EVAL, TRACE_DEBUG, "JIT: guard failed at line %d", ast->lines[node]);
+            return 0;
+        }
+    }
+    uint64_t iterations = loop->code(variables);
+    TRACE(TRACE_EVAL, TRACE_DEBUG, "JIT: ran %llu iterations at line %d",
+          (unsigned long long)iterations, ast->lines[node]);
+    if (iterations > 0) {
+        for (int i = 0; i < loop->count; i++) {
+            if (loop->assigned[i]) {
+                globals[loop->slots[i]] = NUMBER_VAL(variables[i]);
+            }
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,29 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "parser.h"
+#include "value.h"
+
+// Baseline JIT for the tree walker (x86-64 Linux with NaN-boxed values;
+// elsewhere it never compiles anything). The tree walker reports each
+// iteration of a while loop. Once a loop gets hot, it is compiled from fixed
+// instruction templates, provided its condition is a comparison and its body
+// only assigns arithmetic on numbers and variables. The compiled loop keeps
+// every variable in an XMM register and runs to completion. It is only
+// entered when the variables it reads hold numbers; otherwise the tree walker
+// runs the iteration itself.
+#ifndef JIT_HOT_LOOP
+#define JIT_HOT_LOOP 1000 // Iterations the tree walker runs before compiling
+#endif
+
+// Compiled loops of one program, for one run of it at a time
+typedef struct Jit Jit;
+
+Jit* jit_create(Ast *ast);
+void jit_free(Jit *jit);
+
+// Called when the condition of `loop` has just been true. Returns 1 if the
+// compiled loop ran the remaining iterations, or 0 to run the body as usual.
+int jit_loop(Jit *jit, Ast *ast, NodeId loop, Value *globals);
+
+#endif // JIT_H
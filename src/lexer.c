@@ -1,24 +1,39 @@
 #include "lexer.h"
+#include "trace.h"
+#include "number.h"
 #include <stddef.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
 #include <stdio.h>
 
-Lexer* init_lexer(char *input) {
+Lexer* init_lexer(const char *input, size_t length, Arena *arena) {
     Lexer *lexer = (Lexer*)malloc(sizeof(Lexer));
     lexer->input = input;
+    lexer->length = length;
+    lexer->end = input + length;
     lexer->pos = 0;
-    lexer->current_token = (Token){TOKEN_EOF, 0, NULL}; // Initialize name to NULL
+    lexer->line = 1;
+    lexer->current_token = (Token){TOKEN_EOF, 0, 0, 0, 1};
+    lexer->arena = arena;
+    lexer->failed = 0;
+    lexer->diagnostics = NULL; // stderr
+    intern_table_init(&lexer->strings, arena);
     return lexer;
 }
 
+void free_lexer(Lexer *lexer) {
+    if (!lexer) return;
+    intern_table_free(&lexer->strings);
+    free(lexer);
+}
+
 void advance(Lexer *lexer) {
     lexer->pos++;
 }
 
 char current_char(Lexer *lexer) {
-    if (lexer->pos < (size_t)strlen(lexer->input)) { // Explicitly cast strlen to size_t
+    if (lexer->pos < lexer->length) {
         return lexer->input[lexer->pos];
     }
     return '\0';
@@ -26,6 +41,7 @@ char current_char(Lexer *lexer) {
 
 void skip_whitespace(Lexer *lexer) {
     while (isspace(current_char(lexer))) {
+        if (current_char(lexer) == '\n') lexer->line++;
         advance(lexer);
     }
 }
@@ -37,54 +53,66 @@ void skip_newline(Lexer *lexer) {
     }
 }
 
+// Digits with at most one '.', read straight from the source
 Token number(Lexer *lexer) {
-    char buffer[64];
-    int index = 0;
+    size_t start = lexer->pos;
+    int points = 0;
     while (isdigit(current_char(lexer)) || current_char(lexer) == '.') {
-        buffer[index++] = current_char(lexer);
+        points += current_char(lexer) == '.';
         advance(lexer);
     }
-    buffer[index] = '\0';
-    return (Token){TOKEN_NUMBER, atof(buffer), NULL}; // Initialize name to NULL
+    size_t length = lexer->pos - start;
+    if (points > 1) {
+        io_report(lexer->diagnostics, "Malformed number on line %d: %.*s", lexer->line, (int)length, lexer->input + start);
+        lexer->failed = 1;
+        return (Token){TOKEN_EOF, 0, 0, 0, lexer->line};
+    }
+    double value = parse_decimal(lexer->input + start, length);
+    return (Token){TOKEN_NUMBER, value, start, length, lexer->line};
 }
 
 Token string(Lexer *lexer) {
-    char buffer[256];
-    int index = 0;
+    int line = lexer->line;
     advance(lexer); // Skip the opening quote
-    while (current_char(lexer) != '"' && current_char(lexer) != '\0') {
-        buffer[index++] = current_char(lexer);
-        advance(lexer);
+    size_t start = lexer->pos;
+    const char *close = memchr(lexer->input + start, '"', lexer->length - start);
+    size_t length = close ? (size_t)(close - (lexer->input + start)) : lexer->length - start;
+    for (const char *c = lexer->input + start; (c = memchr(c, '\n', length - (c - (lexer->input + start)))); c++) {
+        lexer->line++; // Literals may span lines
     }
-    buffer[index] = '\0';
+    lexer->pos = start + length;
     advance(lexer); // Skip the closing quote
-    return (Token){TOKEN_STRING, 0, strdup(buffer)};
+    return (Token){TOKEN_STRING, 0, start, length, line};
+}
+
+// Compare a token span against a NUL-terminated keyword
+static int span_equals(const char *span, size_t length, const char *keyword) {
+    return strncmp(span, keyword, length) == 0 && keyword[length] == '\0';
 }
 
 Token identifier_or_keyword(Lexer *lexer) {
-    char buffer[64];
-    int index = 0;
+    size_t start = lexer->pos;
     while (isalpha(current_char(lexer)) || current_char(lexer) == '_') {
-        buffer[index++] = current_char(lexer);
         advance(lexer);
     }
-    buffer[index] = '\0';
+    size_t length = lexer->pos - start;
+    const char *text = lexer->input + start;
 
-    if (strcmp(buffer, "print") == 0) return (Token){TOKEN_PRINT, 0, NULL};
-    if (strcmp(buffer, "if") == 0) return (Token){TOKEN_IF, 0, NULL};
-    if (strcmp(buffer, "else") == 0) return (Token){TOKEN_ELSE, 0, NULL};
-    if (strcmp(buffer, "while") == 0) return (Token){TOKEN_WHILE, 0, NULL};
-    if (strcmp(buffer, "true") == 0) return (Token){TOKEN_TRUE, 1, NULL};
-    if (strcmp(buffer, "false") == 0) return (Token){TOKEN_FALSE, 0, NULL};
-    if (strcmp(buffer, "input") == 0) return (Token){TOKEN_INPUT, 0, NULL};
-    if (strcmp(buffer, "var") == 0) return (Token){TOKEN_VAR, 0, NULL};
+    if (span_equals(text, length, "print")) return (Token){TOKEN_PRINT, 0, start, length, lexer->line};
+    if (span_equals(text, length, "if")) return (Token){TOKEN_IF, 0, start, length, lexer->line};
+    if (span_equals(text, length, "else")) return (Token){TOKEN_ELSE, 0, start, length, lexer->line};
+    if (span_equals(text, length, "while")) return (Token){TOKEN_WHILE, 0, start, length, lexer->line};
+    if (span_equals(text, length, "true")) return (Token){TOKEN_TRUE, 1, start, length, lexer->line};
+    if (span_equals(text, length, "false")) return (Token){TOKEN_FALSE, 0, start, length, lexer->line};
+    if (span_equals(text, length, "input")) return (Token){TOKEN_INPUT, 0, start, length, lexer->line};
+    if (span_equals(text, length, "var")) return (Token){TOKEN_VAR, 0, start, length, lexer->line};
 
-    return (Token){TOKEN_IDENTIFIER, 0, strdup(buffer)};
+    return (Token){TOKEN_IDENTIFIER, 0, start, length, lexer->line};
 }
 
 // In the get_next_token function, add support for newlines
 Token get_next_token(Lexer *lexer) {
-    while (current_char(lexer) != '\0') {
+    while (!lexer->failed && current_char(lexer) != '\0') {
         if (isspace(current_char(lexer))) {
             skip_whitespace(lexer);
             continue;
@@ -104,92 +132,100 @@ Token get_next_token(Lexer *lexer) {
         }
         if (current_char(lexer) == '+') {
             advance(lexer);
-            return (Token){TOKEN_PLUS, 0, NULL};
+            return (Token){TOKEN_PLUS, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '-') {
             advance(lexer);
-            return (Token){TOKEN_MINUS, 0, NULL};
+            return (Token){TOKEN_MINUS, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '*') {
             advance(lexer);
-            return (Token){TOKEN_MUL, 0, NULL};
+            return (Token){TOKEN_MUL, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '/') {
             advance(lexer);
-            return (Token){TOKEN_DIV, 0, NULL};
+            return (Token){TOKEN_DIV, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '(') {
             advance(lexer);
-            return (Token){TOKEN_LPAREN, 0, NULL};
+            return (Token){TOKEN_LPAREN, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == ')') {
             advance(lexer);
-            return (Token){TOKEN_RPAREN, 0, NULL};
+            return (Token){TOKEN_RPAREN, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '=') {
             advance(lexer);
             if (current_char(lexer) == '=') {
                 advance(lexer);
-                return (Token){TOKEN_EQ, 0, NULL};
+                return (Token){TOKEN_EQ, 0, 0, 0, lexer->line};
             }
-            return (Token){TOKEN_ASSIGN, 0, NULL};
+            return (Token){TOKEN_ASSIGN, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '!') {
             advance(lexer);
             if (current_char(lexer) == '=') {
                 advance(lexer);
-                return (Token){TOKEN_NEQ, 0, NULL};
+                return (Token){TOKEN_NEQ, 0, 0, 0, lexer->line};
             }
-            return (Token){TOKEN_NOT, 0, NULL};
+            return (Token){TOKEN_NOT, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '<') {
             advance(lexer);
             if (current_char(lexer) == '=') {
                 advance(lexer);
-                return (Token){TOKEN_LTE, 0, NULL};
+                return (Token){TOKEN_LTE, 0, 0, 0, lexer->line};
             }
-            return (Token){TOKEN_LT, 0, NULL};
+            return (Token){TOKEN_LT, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '>') {
             advance(lexer);
             if (current_char(lexer) == '=') {
                 advance(lexer);
-                return (Token){TOKEN_GTE, 0, NULL};
+                return (Token){TOKEN_GTE, 0, 0, 0, lexer->line};
             }
-            return (Token){TOKEN_GT, 0, NULL};
+            return (Token){TOKEN_GT, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '&') {
             advance(lexer);
             if (current_char(lexer) == '&') {
                 advance(lexer);
-                return (Token){TOKEN_AND, 0, NULL};
+                return (Token){TOKEN_AND, 0, 0, 0, lexer->line};
             }
         }
         if (current_char(lexer) == '|') {
             advance(lexer);
             if (current_char(lexer) == '|') {
                 advance(lexer);
-                return (Token){TOKEN_OR, 0, NULL};
+                return (Token){TOKEN_OR, 0, 0, 0, lexer->line};
             }
         }
         if (current_char(lexer) == ';') {
             advance(lexer);
-            return (Token){TOKEN_SEMICOLON, 0, NULL};
+            return (Token){TOKEN_SEMICOLON, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '{') {
             advance(lexer);
-            return (Token){TOKEN_LBRACE, 0, NULL};
+            return (Token){TOKEN_LBRACE, 0, 0, 0, lexer->line};
         }
         if (current_char(lexer) == '}') {
             advance(lexer);
-            return (Token){TOKEN_RBRACE, 0, NULL};
+            return (Token){TOKEN_RBRACE, 0, 0, 0, lexer->line};
         }
-        fprintf(stderr, "Unknown character: %c\n", current_char(lexer));
-        exit(1);
+        io_report(lexer->diagnostics, "Unknown character: %c", current_char(lexer));
+        lexer->failed = 1;
     }
-    return (Token){TOKEN_EOF, 0, NULL};
+    return (Token){TOKEN_EOF, 0, 0, 0, lexer->line};
 }
 
 void lexer_advance(Lexer *lexer) {
     lexer->current_token = get_next_token(lexer);
+    TRACE(TRACE_LEXER, TRACE_DEBUG, "token: type=%d at %zu, length %zu",
+          lexer->current_token.type, lexer->current_token.start, lexer->current_token.length);
+}
+
+// Materialise the text of an identifier or string token. The result is
+// interned in the program's arena, so it outlives the source buffer.
+char* token_name(Lexer *lexer, Token token) {
+    return intern(&lexer->strings, lexer->input + token.start, token.length);
 }
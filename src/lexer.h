@@ -4,6 +4,9 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include "arena.h"
+#include "intern.h"
+#include "io.h"
 
 typedef enum {
     TOKEN_NUMBER,
@@ -36,22 +39,53 @@ typedef enum {
     TOKEN_RBRACE,
     TOKEN_INPUT,
     TOKEN_VAR,
-    TOKEN_STRING   // Add this line for string literals
+    TOKEN_STRING,  // Add this line for string literals
+
+    // Node kinds the type pass (types.h) specialises operators into; the
+    // lexer never produces them
+    NODE_ADD_NUMBERS,
+    NODE_CONCAT,
+    NODE_EQ_NUMBERS,
+    NODE_NEQ_NUMBERS,
+    NODE_EQ_STRINGS,
+    NODE_NEQ_STRINGS,
+
+    // Kinds the tree walker rewrites +, == and != into for the operand types
+    // they meet at run time. They check those types and fall back to the
+    // generic kind when they differ.
+    NODE_GUARDED_ADD_NUMBERS,
+    NODE_GUARDED_CONCAT,       // string + string
+    NODE_GUARDED_EQ_NUMBERS,
+    NODE_GUARDED_NEQ_NUMBERS,
+    NODE_GUARDED_EQ_STRINGS,
+    NODE_GUARDED_NEQ_STRINGS
 } TokenType;
 
+// Tokens do not own text: identifiers and string literals are a span of the
+// source buffer, materialised with token_name() only when a node needs them
 typedef struct {
     TokenType type;
     double value;
-    char *name;
+    size_t start;  // Offset of the token text in the source
+    size_t length; // Length of the token text (string literals exclude quotes)
+    int line;      // 1-based source line the token starts on
 } Token;
 
 typedef struct {
-    char *input;
+    const char *input;   // Source bytes, not necessarily NUL-terminated
+    size_t length;
+    const char *end;     // input + length
     size_t pos;
+    int line;            // Line of the character at pos
     Token current_token;
+    Arena *arena;        // Owns the strings of the program being parsed
+    InternTable strings;
+    int failed;          // A syntax error was reported; only TOKEN_EOF follows
+    Io *diagnostics;     // Where errors in the source are reported; NULL for stderr
 } Lexer;
 
-Lexer* init_lexer(char *input);
+Lexer* init_lexer(const char *input, size_t length, Arena *arena);
+void free_lexer(Lexer *lexer);
 void advance(Lexer *lexer);
 char current_char(Lexer *lexer);
 void skip_whitespace(Lexer *lexer);
@@ -60,5 +94,6 @@ Token string(Lexer *lexer); // Add this line for string literals
 Token identifier_or_keyword(Lexer *lexer);
 Token get_next_token(Lexer *lexer);
 void lexer_advance(Lexer *lexer);
+char* token_name(Lexer *lexer, Token token);
 
 #endif // LEXER_H
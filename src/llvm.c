@@ -0,0 +1,759 @@
+#include "llvm.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How a value is represented in the generated code. The types themselves
+// come from the type pass (types.h); a variable that is only ever assigned
+// numbers stays an unboxed double.
+typedef enum {
+    TYPE_NONE,   // Variable that is never assigned
+    TYPE_NUMBER, // double
+    TYPE_BOOL,   // i1
+    TYPE_VALUE   // i64 boxed Value, only touched by the runtime
+} Type;
+
+static const char *llvm_types[] = {"double", "double", "i1", "i64"};
+
+// An SSA operand: the result of an instruction or a constant
+typedef struct {
+    Type type;
+    int is_constant;
+    uint64_t bits; // Constant: double bits, 0/1, or a boxed word
+    uint32_t reg;  // %t<reg> otherwise
+} Operand;
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+// An operator waiting for its operands: index counts those emitted, left
+// holds the first one's value, and and / or keep the blocks they branch
+// between
+typedef struct {
+    NodeId node;
+    uint32_t index;
+    Operand left;
+    uint32_t from, rhs, end;
+} ExpressionFrame;
+
+typedef struct {
+    Ast *ast;
+    Resolution *resolution;
+    uint8_t *slot_types; // Slot -> Type
+    Operand *values;     // Slot -> value the variable holds at this point
+    Operand *defined;    // Slot -> i1, whether it has been assigned yet
+    uint8_t *marks;      // Scratch set of slots
+    uint8_t *names_used; // Slot -> its name is needed for an error message
+    uint8_t *strings_used; // Name index -> used as a string literal
+    Buffer *out;
+    uint32_t next_reg;
+    uint32_t next_label;
+    uint32_t label;      // Block being emitted into
+    ExpressionFrame *frames;
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+} Emitter;
+
+static void *checked_alloc(void *memory) {
+    if (!memory) {
+        fprintf(stderr, "Out of memory while emitting LLVM IR\n");
+        exit(1);
+    }
+    return memory;
+}
+
+static void buffer_append(Buffer *buffer, const char *chars, size_t length) {
+    if (buffer->length + length + 1 > buffer->capacity) {
+        while (buffer->length + length + 1 > buffer->capacity) {
+            buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        }
+        buffer->data = checked_alloc(realloc(buffer->data, buffer->capacity));
+    }
+    memcpy(buffer->data + buffer->length, chars, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+}
+
+static void emit(Emitter *e, const char *format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if ((size_t)length < sizeof(text)) {
+        buffer_append(e->out, text, (size_t)length);
+        return;
+    }
+    char *long_text = checked_alloc(malloc((size_t)length + 1));
+    va_start(args, format);
+    vsnprintf(long_text, (size_t)length + 1, format, args);
+    va_end(args);
+    buffer_append(e->out, long_text, (size_t)length);
+    free(long_text);
+}
+
+static Operand constant(Type type, uint64_t bits) {
+    Operand operand = {type, 1, bits, 0};
+    return operand;
+}
+
+static Operand number_constant(double number) {
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    return constant(TYPE_NUMBER, bits);
+}
+
+static Operand register_value(Type type, uint32_t reg) {
+    Operand operand = {type, 0, 0, reg};
+    return operand;
+}
+
+static Operand new_value(Emitter *e, Type type) {
+    return register_value(type, e->next_reg++);
+}
+
+// Text of an operand, written into `text` (at least 24 bytes)
+static const char* operand_text(Operand operand, char *text) {
+    if (!operand.is_constant) {
+        sprintf(text, "%%t%" PRIu32, operand.reg);
+    } else if (operand.type == TYPE_BOOL) {
+        strcpy(text, operand.bits ? "true" : "false");
+    } else if (operand.type == TYPE_VALUE) {
+        sprintf(text, "%" PRId64, (int64_t)operand.bits);
+    } else {
+        sprintf(text, "0x%016" PRIX64, operand.bits); // Exact, unlike decimal
+    }
+    return text;
+}
+
+static int is_constant_bool(Operand operand, int value) {
+    return operand.is_constant && operand.type == TYPE_BOOL && operand.bits == (uint64_t)value;
+}
+
+static void start_block(Emitter *e, uint32_t label) {
+    emit(e, "L%" PRIu32 ":\n", label);
+    e->label = label;
+}
+
+// Representation of a value of a type the type pass proved
+static Type representation(NodeType type) {
+    switch (type) {
+        case NODE_TYPE_NUMBER: return TYPE_NUMBER;
+        case NODE_TYPE_BOOL: return TYPE_BOOL;
+        default: return TYPE_VALUE; // Strings, and anything not proven
+    }
+}
+
+// Representation of every variable assigned in a block: the one shared by
+// every value assigned to it, or a boxed Value if they differ
+static void assign_representations(Emitter *e, NodeId block) {
+    Ast *ast = e->ast;
+    Type type;
+    int slot;
+    for (uint32_t i = 0; i < ast_statement_count(ast, block); i++) {
+        NodeId node = ast_statements(ast, block)[i];
+        switch (ast_kind(ast, node)) {
+            case TOKEN_ASSIGN:
+                slot = ast->slots[node];
+                type = representation((NodeType)ast->types[ast->left[node]]);
+                if (e->slot_types[slot] != TYPE_NONE && e->slot_types[slot] != type) {
+                    type = TYPE_VALUE;
+                }
+                e->slot_types[slot] = (uint8_t)type;
+                break;
+            case TOKEN_WHILE:
+                assign_representations(e, ast->right[node]);
+                break;
+            case TOKEN_LBRACE:
+                assign_representations(e, node);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Call a runtime function returning `type`, or void if `type` is NULL
+static uint32_t emit_call(Emitter *e, const char *type, const char *function, const char *args) {
+    if (!type) {
+        emit(e, "  call void @%s(%s)\n", function, args);
+        return 0;
+    }
+    uint32_t reg = e->next_reg++;
+    emit(e, "  %%t%" PRIu32 " = call %s @%s(%s)\n", reg, type, function, args);
+    return reg;
+}
+
+// Widen an i1 to the int the runtime takes, returning its register
+static uint32_t emit_zext(Emitter *e, Operand operand) {
+    char text[24];
+    uint32_t reg = e->next_reg++;
+    emit(e, "  %%t%" PRIu32 " = zext i1 %s to i32\n", reg, operand_text(operand, text));
+    return reg;
+}
+
+static Operand box(Emitter *e, Operand operand) {
+    char text[24], args[64];
+    if (operand.type == TYPE_VALUE) {
+        return operand;
+    }
+    if (operand.type == TYPE_BOOL) {
+        sprintf(args, "i32 %%t%" PRIu32, emit_zext(e, operand));
+        return register_value(TYPE_VALUE, emit_call(e, "i64", "calc_box_bool", args));
+    }
+    sprintf(args, "double %s", operand_text(operand, text));
+    return register_value(TYPE_VALUE, emit_call(e, "i64", "calc_box_number", args));
+}
+
+// Numeric operand of arithmetic or an ordering (consumes a boxed operand)
+static Operand to_number(Emitter *e, Operand operand) {
+    char text[24], args[64];
+    if (operand.type == TYPE_NUMBER) {
+        return operand;
+    }
+    operand = box(e, operand);
+    sprintf(args, "i64 %s", operand_text(operand, text));
+    return register_value(TYPE_NUMBER, emit_call(e, "double", "calc_number", args));
+}
+
+// Result of a runtime predicate returning int, as an i1
+static Operand predicate_result(Emitter *e, const char *function, const char *args) {
+    uint32_t word = emit_call(e, "i32", function, args);
+    Operand truth = new_value(e, TYPE_BOOL);
+    emit(e, "  %%t%" PRIu32 " = icmp ne i32 %%t%" PRIu32 ", 0\n", truth.reg, word);
+    return truth;
+}
+
+// Condition of a while, and, or or not. As in the other executors only true
+// is true, so a number is always false.
+static Operand to_bool(Emitter *e, Operand operand) {
+    char text[24], args[64];
+    if (operand.type == TYPE_BOOL) {
+        return operand;
+    }
+    if (operand.type == TYPE_NUMBER) {
+        return constant(TYPE_BOOL, 0);
+    }
+    sprintf(args, "i64 %s", operand_text(operand, text));
+    return predicate_result(e, "calc_truthy", args);
+}
+
+// Fail with "Undefined variable" unless the slot has been assigned
+static void check_defined(Emitter *e, int slot) {
+    char text[24];
+    Operand defined = e->defined[slot];
+    if (is_constant_bool(defined, 1)) {
+        return;
+    }
+    uint32_t ok = e->next_label++;
+    if (!defined.is_constant) {
+        uint32_t fail = e->next_label++;
+        emit(e, "  br i1 %s, label %%L%" PRIu32 ", label %%L%" PRIu32 "\n",
+             operand_text(defined, text), ok, fail);
+        start_block(e, fail);
+    }
+    size_t length = strlen(e->resolution->names[slot]) + 1;
+    e->names_used[slot] = 1;
+    emit(e, "  call void @calc_undefined(i8* getelementptr inbounds ([%zu x i8], [%zu x i8]* @name.%d, i64 0, i64 0))\n",
+         length, length, slot);
+    emit(e, "  unreachable\n");
+    start_block(e, ok); // Dead code if the check cannot pass
+}
+
+static Operand read_variable(Emitter *e, NodeId node) {
+    char text[24], args[64];
+    int slot = e->ast->slots[node];
+    if (e->ast->flags[node] & AST_CHECK_DEFINED) {
+        check_defined(e, slot);
+    }
+    if (e->slot_types[slot] == TYPE_NONE) {
+        return number_constant(0); // Only reachable past a failed check
+    }
+    Operand value = e->values[slot];
+    if (value.type == TYPE_VALUE && !value.is_constant) {
+        // The variable keeps its reference; the reader gets one of its own
+        sprintf(args, "i64 %s", operand_text(value, text));
+        return register_value(TYPE_VALUE, emit_call(e, "i64", "calc_retain", args));
+    }
+    return value;
+}
+
+static Operand emit_arithmetic(Emitter *e, const char *instruction, Operand left, Operand right) {
+    char left_text[24], right_text[24];
+    left = to_number(e, left);
+    right = to_number(e, right);
+    Operand result = new_value(e, TYPE_NUMBER);
+    emit(e, "  %%t%" PRIu32 " = %s double %s, %s\n", result.reg, instruction,
+         operand_text(left, left_text), operand_text(right, right_text));
+    return result;
+}
+
+static Operand emit_comparison(Emitter *e, const char *condition, Operand left, Operand right) {
+    char left_text[24], right_text[24];
+    left = to_number(e, left);
+    right = to_number(e, right);
+    Operand result = new_value(e, TYPE_BOOL);
+    emit(e, "  %%t%" PRIu32 " = fcmp %s double %s, %s\n", result.reg, condition,
+         operand_text(left, left_text), operand_text(right, right_text));
+    return result;
+}
+
+// == and != compare numbers and booleans inline and anything else through
+// the runtime, which compares as strings if either side is one
+static Operand emit_equality(Emitter *e, int negate, Operand left, Operand right) {
+    char left_text[24], right_text[24], args[64];
+    Operand result;
+    if (left.type == TYPE_NUMBER && right.type == TYPE_NUMBER) {
+        result = new_value(e, TYPE_BOOL);
+        emit(e, "  %%t%" PRIu32 " = fcmp %s double %s, %s\n", result.reg, negate ? "une" : "oeq",
+             operand_text(left, left_text), operand_text(right, right_text));
+        return result;
+    }
+    if (left.type == TYPE_BOOL && right.type == TYPE_BOOL) {
+        result = new_value(e, TYPE_BOOL);
+        emit(e, "  %%t%" PRIu32 " = icmp %s i1 %s, %s\n", result.reg, negate ? "ne" : "eq",
+             operand_text(left, left_text), operand_text(right, right_text));
+        return result;
+    }
+    left = box(e, left);
+    right = box(e, right);
+    sprintf(args, "i64 %s, i64 %s", operand_text(left, left_text), operand_text(right, right_text));
+    result = predicate_result(e, "calc_equal", args);
+    if (negate) {
+        Operand inverse = new_value(e, TYPE_BOOL);
+        emit(e, "  %%t%" PRIu32 " = xor i1 %%t%" PRIu32 ", true\n", inverse.reg, result.reg);
+        return inverse;
+    }
+    return result;
+}
+
+// Value of a node without operands
+static Operand emit_leaf(Emitter *e, NodeId node) {
+    Ast *ast = e->ast;
+    char args[128];
+    if (node == AST_NONE) {
+        return number_constant(0);
+    }
+    switch (ast_kind(ast, node)) {
+        case TOKEN_NUMBER:
+            return number_constant(ast_number(ast, node));
+        case TOKEN_STRING:
+            e->strings_used[ast->data[node]] = 1;
+            sprintf(args, "i8* getelementptr inbounds ([%zu x i8], [%zu x i8]* @string.%" PRIu32 ", i64 0, i64 0)",
+                    strlen(ast_name(ast, node)) + 1, strlen(ast_name(ast, node)) + 1, ast->data[node]);
+            return register_value(TYPE_VALUE, emit_call(e, "i64", "calc_string", args));
+        case TOKEN_TRUE:
+            return constant(TYPE_BOOL, 1);
+        case TOKEN_FALSE:
+            return constant(TYPE_BOOL, 0);
+        case TOKEN_IDENTIFIER:
+            return read_variable(e, node);
+        default:
+            fprintf(stderr, "Unknown node type: %d\n", ast_kind(ast, node));
+            return number_constant(0);
+    }
+}
+
+static int is_operator(Ast *ast, NodeId node) {
+    if (node == AST_NONE) return 0;
+    switch (ast_kind(ast, node)) {
+        case TOKEN_PLUS: case TOKEN_MINUS: case TOKEN_MUL: case TOKEN_DIV:
+        case TOKEN_EQ: case TOKEN_NEQ: case TOKEN_LT: case TOKEN_GT: case TOKEN_LTE: case TOKEN_GTE:
+        case TOKEN_AND: case TOKEN_OR: case TOKEN_NOT: case TOKEN_INPUT:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Take the value of the operand the frame's operator last asked for, in
+// *value, and emit what follows it. Returns 1 with the next operand to
+// emit in *operand, or 0 with the operator's result in *value.
+static int resume_operator(Emitter *e, ExpressionFrame *frame, Operand *value, NodeId *operand) {
+    Ast *ast = e->ast;
+    NodeId node = frame->node;
+    TokenType kind = ast_kind(ast, node);
+    char text[24], left_text[24], right_text[24], args[128];
+    Operand result;
+    uint32_t index = frame->index++;
+    int unary = ast->left[node] == AST_NONE && (kind == TOKEN_MINUS || kind == TOKEN_NOT);
+    if (index == 0) {
+        *operand = unary ? ast->right[node] : ast->left[node];
+        return 1;
+    }
+    if (index == 1 && !unary && kind != TOKEN_INPUT) {
+        // Between the operands
+        frame->left = *value;
+        if (kind == TOKEN_PLUS && ast->types[node] != NODE_TYPE_NUMBER) {
+            frame->left = box(e, frame->left);
+        } else if (kind == TOKEN_AND || kind == TOKEN_OR) {
+            // and/or evaluate their right operand in a block of its own, only
+            // when the left one has not decided the result
+            frame->left = to_bool(e, frame->left);
+            frame->from = e->label;
+            frame->rhs = e->next_label++;
+            frame->end = e->next_label++;
+            emit(e, "  br i1 %s, label %%L%" PRIu32 ", label %%L%" PRIu32 "\n", operand_text(frame->left, text),
+                 kind == TOKEN_AND ? frame->rhs : frame->end, kind == TOKEN_AND ? frame->end : frame->rhs);
+            start_block(e, frame->rhs);
+        }
+        *operand = ast->right[node];
+        return 1;
+    }
+    Operand left = frame->left, right = *value;
+    switch (kind) {
+        case TOKEN_PLUS:
+            if (ast->types[node] == NODE_TYPE_NUMBER) {
+                *value = emit_arithmetic(e, "fadd", left, right);
+                break;
+            }
+            right = box(e, right);
+            sprintf(args, "i64 %s, i64 %s", operand_text(left, left_text), operand_text(right, right_text));
+            *value = register_value(TYPE_VALUE, emit_call(e, "i64", "calc_add", args));
+            break;
+        case TOKEN_MINUS:
+            if (!unary) {
+                *value = emit_arithmetic(e, "fsub", left, right);
+                break;
+            }
+            right = to_number(e, right); // Unary negation
+            result = new_value(e, TYPE_NUMBER);
+            emit(e, "  %%t%" PRIu32 " = fneg double %s\n", result.reg, operand_text(right, text));
+            *value = result;
+            break;
+        case TOKEN_MUL:
+            *value = emit_arithmetic(e, "fmul", left, right);
+            break;
+        case TOKEN_DIV:
+            *value = emit_arithmetic(e, "fdiv", left, right);
+            break;
+        case TOKEN_EQ:
+        case TOKEN_NEQ:
+            *value = emit_equality(e, kind == TOKEN_NEQ, left, right);
+            break;
+        case TOKEN_LT:
+            *value = emit_comparison(e, "olt", left, right);
+            break;
+        case TOKEN_GT:
+            *value = emit_comparison(e, "ogt", left, right);
+            break;
+        case TOKEN_LTE:
+            *value = emit_comparison(e, "ole", left, right);
+            break;
+        case TOKEN_GTE:
+            *value = emit_comparison(e, "oge", left, right);
+            break;
+        case TOKEN_AND:
+        case TOKEN_OR: {
+            right = to_bool(e, right);
+            uint32_t rhs_end = e->label;
+            emit(e, "  br label %%L%" PRIu32 "\n", frame->end);
+            start_block(e, frame->end);
+            result = new_value(e, TYPE_BOOL);
+            emit(e, "  %%t%" PRIu32 " = phi i1 [ %s, %%L%" PRIu32 " ], [ %s, %%L%" PRIu32 " ]\n", result.reg,
+                 kind == TOKEN_AND ? "false" : "true", frame->from, operand_text(right, right_text), rhs_end);
+            *value = result;
+            break;
+        }
+        case TOKEN_NOT:
+            right = to_bool(e, right);
+            result = new_value(e, TYPE_BOOL);
+            emit(e, "  %%t%" PRIu32 " = xor i1 %s, true\n", result.reg, operand_text(right, text));
+            *value = result;
+            break;
+        default: // TOKEN_INPUT
+            right = box(e, right);
+            sprintf(args, "i64 %s", operand_text(right, text));
+            *value = register_value(TYPE_VALUE, emit_call(e, "i64", "calc_input", args));
+            break;
+    }
+    return 0;
+}
+
+// Emit an expression. Operators wait in frames on the heap while their
+// operands are emitted, so nesting depth costs no native stack.
+static Operand emit_expression(Emitter *e, NodeId node) {
+    Operand value = number_constant(0);
+    for (;;) {
+        if (is_operator(e->ast, node)) {
+            if (e->frame_count == e->frame_capacity) {
+                e->frame_capacity = e->frame_capacity ? e->frame_capacity * 2 : 64;
+                e->frames = checked_alloc(realloc(e->frames, e->frame_capacity * sizeof(ExpressionFrame)));
+            }
+            e->frames[e->frame_count++] = (ExpressionFrame){.node = node};
+        } else {
+            value = emit_leaf(e, node);
+        }
+        // Resume operators until one has another operand to emit
+        for (;;) {
+            if (e->frame_count == 0) return value;
+            if (resume_operator(e, &e->frames[e->frame_count - 1], &value, &node)) break;
+            e->frame_count--;
+        }
+    }
+}
+
+static void emit_print(Emitter *e, const char *label, Operand value) {
+    char text[24], args[128];
+    int length = (int)strlen(label) + 1;
+    int offset = sprintf(args, "i8* getelementptr inbounds ([%d x i8], [%d x i8]* @label.%s, i64 0, i64 0), ",
+                         length, length, label);
+    if (value.type == TYPE_BOOL) {
+        sprintf(args + offset, "i32 %%t%" PRIu32, emit_zext(e, value));
+        emit_call(e, NULL, "calc_print_bool", args);
+    } else if (value.type == TYPE_VALUE) {
+        sprintf(args + offset, "i64 %s", operand_text(value, text));
+        emit_call(e, NULL, "calc_print_value", args);
+    } else {
+        sprintf(args + offset, "double %s", operand_text(value, text));
+        emit_call(e, NULL, "calc_print_number", args);
+    }
+}
+
+// Drop the reference a boxed variable holds, if it holds one
+static void release_variable(Emitter *e, int slot) {
+    char text[24], args[64];
+    Operand value = e->values[slot];
+    if (e->slot_types[slot] == TYPE_VALUE && !value.is_constant) {
+        sprintf(args, "i64 %s", operand_text(value, text));
+        emit_call(e, NULL, "calc_release", args);
+    }
+}
+
+// Slots assigned anywhere in a block, nested loops included
+static void collect_assigned(Emitter *e, NodeId block, int **slots, int *count, int *capacity) {
+    Ast *ast = e->ast;
+    for (uint32_t i = 0; i < ast_statement_count(ast, block); i++) {
+        NodeId node = ast_statements(ast, block)[i];
+        TokenType kind = ast_kind(ast, node);
+        if (kind == TOKEN_ASSIGN && !e->marks[ast->slots[node]]) {
+            e->marks[ast->slots[node]] = 1;
+            if (*count == *capacity) {
+                *capacity = *capacity ? *capacity * 2 : 16;
+                *slots = checked_alloc(realloc(*slots, (size_t)*capacity * sizeof(int)));
+            }
+            (*slots)[(*count)++] = ast->slots[node];
+        } else if (kind == TOKEN_WHILE) {
+            collect_assigned(e, ast->right[node], slots, count, capacity);
+        } else if (kind == TOKEN_LBRACE) {
+            collect_assigned(e, node, slots, count, capacity);
+        }
+    }
+}
+
+static void emit_statements(Emitter *e, NodeId block);
+
+// A while loop is a header block of phis for the variables its body assigns,
+// followed by the condition and the body. The values coming round the back
+// edge are only known once the body has been emitted, so the condition and
+// body go to a buffer of their own and the header is written in front.
+static void emit_while(Emitter *e, NodeId node) {
+    char text[24], entry_text[24], back_text[24];
+    int *slots = NULL, count = 0, capacity = 0;
+    collect_assigned(e, e->ast->right[node], &slots, &count, &capacity);
+
+    // Per slot: value and definedness on entry, then the phis replacing them
+    Operand *entry = checked_alloc(malloc(((size_t)count * 4 + 1) * sizeof(Operand)));
+    Operand *phis = entry + 2 * count;
+    for (int i = 0; i < count; i++) {
+        int slot = slots[i];
+        e->marks[slot] = 0;
+        entry[2 * i] = e->values[slot];
+        entry[2 * i + 1] = e->defined[slot];
+        e->values[slot] = new_value(e, (Type)e->slot_types[slot]);
+        if (!is_constant_bool(e->defined[slot], 1)) {
+            e->defined[slot] = new_value(e, TYPE_BOOL);
+        }
+        phis[2 * i] = e->values[slot];
+        phis[2 * i + 1] = e->defined[slot];
+    }
+
+    uint32_t preheader = e->label, header = e->next_label++;
+    uint32_t body = e->next_label++, exit_label = e->next_label++;
+    emit(e, "  br label %%L%" PRIu32 "\n", header);
+
+    Buffer *outer = e->out;
+    Buffer inner = {NULL, 0, 0};
+    e->out = &inner;
+    e->label = header;
+    Operand condition = to_bool(e, emit_expression(e, e->ast->left[node]));
+    emit(e, "  br i1 %s, label %%L%" PRIu32 ", label %%L%" PRIu32 "\n",
+         operand_text(condition, text), body, exit_label);
+    start_block(e, body);
+    emit_statements(e, e->ast->right[node]);
+    uint32_t latch = e->label;
+    emit(e, "  br label %%L%" PRIu32 "\n", header);
+    e->out = outer;
+
+    emit(e, "L%" PRIu32 ":\n", header);
+    for (int i = 0; i < 2 * count; i++) {
+        int slot = slots[i / 2];
+        Operand back = i % 2 ? e->defined[slot] : e->values[slot];
+        if (phis[i].is_constant) {
+            continue; // Defined on entry, so defined throughout
+        }
+        emit(e, "  %s = phi %s [ %s, %%L%" PRIu32 " ], [ %s, %%L%" PRIu32 " ]\n",
+             operand_text(phis[i], text), llvm_types[phis[i].type],
+             operand_text(entry[i], entry_text), preheader, operand_text(back, back_text), latch);
+    }
+    buffer_append(e->out, inner.data ? inner.data : "", inner.length);
+    free(inner.data);
+
+    // The loop is left from its header, where every variable holds its phi
+    for (int i = 0; i < count; i++) {
+        e->values[slots[i]] = phis[2 * i];
+        e->defined[slots[i]] = phis[2 * i + 1];
+    }
+    free(slots);
+    free(entry);
+    start_block(e, exit_label);
+}
+
+static void emit_statement(Emitter *e, NodeId node) {
+    Ast *ast = e->ast;
+    Operand value;
+    int slot;
+    switch (ast_kind(ast, node)) {
+        case TOKEN_PRINT:
+            if (ast->left[node] != AST_NONE) {
+                emit_print(e, "Print", emit_expression(e, ast->left[node]));
+            }
+            break;
+        case TOKEN_ASSIGN:
+            slot = ast->slots[node];
+            value = emit_expression(e, ast->left[node]);
+            // A boxed variable may be read where its type is proven, and
+            // assigned to a variable stored unboxed
+            if (e->slot_types[slot] == TYPE_VALUE) {
+                value = box(e, value);
+            } else if (e->slot_types[slot] == TYPE_NUMBER) {
+                value = to_number(e, value);
+            } else {
+                value = to_bool(e, value);
+            }
+            release_variable(e, slot);
+            e->values[slot] = value;
+            e->defined[slot] = constant(TYPE_BOOL, 1);
+            break;
+        case TOKEN_WHILE:
+            emit_while(e, node);
+            break;
+        case TOKEN_LBRACE:
+            emit_statements(e, node);
+            break;
+        default:
+            if (is_result_expression(ast_kind(ast, node))) {
+                emit_print(e, "Result", emit_expression(e, node));
+            }
+            break;
+    }
+}
+
+static void emit_statements(Emitter *e, NodeId block) {
+    for (uint32_t i = 0; i < ast_statement_count(e->ast, block); i++) {
+        emit_statement(e, ast_statements(e->ast, block)[i]);
+    }
+}
+
+// A NUL-terminated byte array constant
+static void write_bytes(FILE *out, const char *name, const char *chars) {
+    fprintf(out, "@%s = private unnamed_addr constant [%zu x i8] c\"", name, strlen(chars) + 1);
+    for (const unsigned char *c = (const unsigned char *)chars; *c; c++) {
+        if (*c >= ' ' && *c <= '~' && *c != '"' && *c != '\\') {
+            fputc(*c, out);
+        } else {
+            fprintf(out, "\\%02X", *c);
+        }
+    }
+    fprintf(out, "\\00\"\n");
+}
+
+void emit_llvm(Ast *ast, Resolution *resolution, FILE *out) {
+    int slot_count = resolution->slot_count;
+    Emitter e;
+    memset(&e, 0, sizeof(e));
+    e.ast = ast;
+    e.resolution = resolution;
+    e.slot_types = checked_alloc(calloc((size_t)slot_count + 1, 1));
+    e.values = checked_alloc(calloc((size_t)slot_count + 1, sizeof(Operand)));
+    e.defined = checked_alloc(calloc((size_t)slot_count + 1, sizeof(Operand)));
+    e.marks = checked_alloc(calloc((size_t)slot_count + 1, 1));
+    e.names_used = checked_alloc(calloc((size_t)slot_count + 1, 1));
+    e.strings_used = checked_alloc(calloc(ast->name_count + 1, 1));
+
+    assign_representations(&e, ast->root);
+
+    for (int slot = 0; slot < slot_count; slot++) {
+        switch (e.slot_types[slot]) {
+            case TYPE_BOOL:
+                e.values[slot] = constant(TYPE_BOOL, 0);
+                break;
+            case TYPE_VALUE:
+                e.values[slot] = constant(TYPE_VALUE, 0); // The number 0, which owns nothing
+                break;
+            default:
+                e.values[slot] = number_constant(0);
+                break;
+        }
+        e.defined[slot] = constant(TYPE_BOOL, 0);
+    }
+
+    Buffer body = {NULL, 0, 0};
+    e.out = &body;
+    start_block(&e, e.next_label++);
+    emit_statements(&e, ast->root);
+    for (int slot = 0; slot < slot_count; slot++) {
+        release_variable(&e, slot);
+    }
+    emit(&e, "  ret i32 0\n");
+
+    fprintf(out, "; Generated by --emit-llvm; link with the runtime library (runtime.h)\n\n");
+    fprintf(out, "declare i64 @calc_string(i8*) nounwind readnone\n");
+    fprintf(out, "declare i64 @calc_box_number(double) nounwind readnone\n");
+    fprintf(out, "declare i64 @calc_box_bool(i32) nounwind readnone\n");
+    fprintf(out, "declare i64 @calc_retain(i64) nounwind\n");
+    fprintf(out, "declare void @calc_release(i64) nounwind\n");
+    fprintf(out, "declare double @calc_number(i64) nounwind\n");
+    fprintf(out, "declare i32 @calc_truthy(i64) nounwind\n");
+    fprintf(out, "declare i64 @calc_add(i64, i64) nounwind\n");
+    fprintf(out, "declare i32 @calc_equal(i64, i64) nounwind\n");
+    fprintf(out, "declare void @calc_print_number(i8*, double) nounwind\n");
+    fprintf(out, "declare void @calc_print_bool(i8*, i32) nounwind\n");
+    fprintf(out, "declare void @calc_print_value(i8*, i64) nounwind\n");
+    fprintf(out, "declare i64 @calc_input(i64) nounwind\n");
+    fprintf(out, "declare void @calc_undefined(i8*) noreturn nounwind\n\n");
+
+    fprintf(out, "define i32 @main() {\n");
+    fwrite(body.data, 1, body.length, out);
+    fprintf(out, "}\n\n");
+
+    write_bytes(out, "label.Print", "Print");
+    write_bytes(out, "label.Result", "Result");
+    char name[32];
+    for (int slot = 0; slot < slot_count; slot++) {
+        if (e.names_used[slot]) {
+            sprintf(name, "name.%d", slot);
+            write_bytes(out, name, resolution->names[slot]);
+        }
+    }
+    for (uint32_t i = 0; i < ast->name_count; i++) {
+        if (e.strings_used[i]) {
+            sprintf(name, "string.%" PRIu32, i);
+            write_bytes(out, name, ast->names[i]);
+        }
+    }
+
+    free(body.data);
+    free(e.slot_types);
+    free(e.values);
+    free(e.defined);
+    free(e.marks);
+    free(e.names_used);
+    free(e.strings_used);
+    free(e.frames);
+}
@@ -0,0 +1,20 @@
+#ifndef LLVM_H
+#define LLVM_H
+
+#include <stdio.h>
+#include "parser.h"
+#include "resolver.h"
+
+// Ahead-of-time backend: write a resolved program as a textual LLVM IR module
+// whose main() runs it. The program must have been through infer_types()
+// without specialisation, whose proven types decide what stays unboxed. Variables become SSA values, numbers are doubles and
+// booleans i1. A variable assigned values of more than one type holds a boxed
+// Value instead, as do strings. Whatever the generated code cannot do inline
+// is a call into the runtime library (runtime.h), so a native executable is
+//
+//   ./interpreter --emit-llvm prog.calc > prog.ll
+//   opt -O2 prog.ll | llc -O2 -o prog.s
+//   gcc prog.s libcalcrt.a -lm -o prog
+void emit_llvm(Ast *ast, Resolution *resolution, FILE *out);
+
+#endif // LLVM_H
@@ -1,58 +1,456 @@
+#include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
+#include "compiler.h"
+#include "vm.h"
+#include "resolver.h"
+#include "arena.h"
+#include "trace.h"
+#include "profiler.h"
+#include "optimizer.h"
+#include "ir.h"
+#include "llvm.h"
+#include "jit.h"
+#include "types.h"
+#include "context.h"
+#include "io.h"
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <source file>\n", argv[0]);
-        return 1;
+#ifdef CALC_TRACE
+static void dump_trace_at_exit(void) {
+    trace_dump(stderr);
+}
+#endif
+
+typedef struct {
+    int use_tree_walker;
+    int disassemble;
+    int dump_ast;
+    int optimize_ast;
+    int dump_optimized;
+    int use_ssa;
+    int dump_ssa;
+    int emit_llvm_ir;
+    int use_jit;
+    const char *profile_path;
+} Options;
+
+// Map a source file read-only; the lexer works on (pointer, length) so the
+// file is neither copied nor NUL-terminated. Returns NULL, with the reason
+// in ctx->error, if it cannot be read.
+static char* map_source(Context *ctx, const char *path, size_t *length) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        context_fail(ctx, "Failed to open file: %s", strerror(errno));
+        return NULL;
     }
 
-    FILE *file = fopen(argv[1], "r");
-    if (!file) {
-        perror("Failed to open file");
-        return 1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        context_fail(ctx, "Failed to stat file: %s", strerror(errno));
+        close(fd);
+        return NULL;
     }
 
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    *length = (size_t)st.st_size;
+    char *source = "";
+    if (*length > 0) {
+        source = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (source == MAP_FAILED) {
+            context_fail(ctx, "Failed to map file: %s", strerror(errno));
+            close(fd);
+            return NULL;
+        }
+    }
+    close(fd);
 
-    char *source = (char*)malloc(length + 1);
-    if (!source) {
-        perror("Failed to allocate memory");
-        fclose(file);
-        return 1;
+    TRACE(TRACE_LEXER, TRACE_INFO, "mapped %s (%zu bytes)", path, *length);
+    return source;
+}
+
+static void unmap_source(char *source, size_t length) {
+    if (length > 0) {
+        munmap(source, length);
     }
+}
 
-    if (fread(source, 1, length, file) != (size_t)length) {
-        perror("Failed to read file");
-        free(source);
-        fclose(file);
+// Run a resolved program in `ctx`, or compile it with --emit-llvm
+static int run_program(const Options *options, Ast *ast, Resolution *resolution, Arena *arena,
+                       Context *ctx) {
+    if (options->optimize_ast) {
+        optimize(ast, arena);
+    }
+    if (options->use_ssa) {
+        // Falls back to the tree as it is if the IR cannot express it
+        IrProgram *ir = ir_build(ast, resolution);
+        if (ir) {
+            ir_optimize(ir);
+            if (options->dump_ssa) {
+                printf("SSA:\n");
+                ir_print(ir, resolution);
+            }
+            if (ir_lower(ir, resolution, ast) && options->optimize_ast) {
+                optimize(ast, arena); // Fold what propagation exposed
+            }
+            ir_free(ir);
+        }
+    }
+    // Report inconsistent types before anything runs. Specialisation is
+    // skipped for --emit-llvm: llvm.c only handles the unspecialised kinds.
+    infer_types(ast, resolution, options->optimize_ast && !options->emit_llvm_ir);
+    if (options->dump_optimized) {
+        printf("Optimized AST:\n");
+        print_ast(ast);
+    }
+    if (options->emit_llvm_ir) {
+        emit_llvm(ast, resolution, stdout);
         return 1;
     }
-    source[length] = '\0';
-    fclose(file);
 
-    // Debug output to verify file reading
-    printf("Source code:\n%s\n", source);
+    int ok;
+    context_bind(ctx, resolution->slot_count, resolution->names);
+    if (options->use_tree_walker) {
+        if (options->profile_path) {
+            profile_start(ast);
+        }
+        if (options->use_jit) {
+            ctx->jit = jit_create(ast);
+        }
+        ok = interpret_program(ctx, ast);
+        jit_free(ctx->jit);
+        ctx->jit = NULL;
+        if (options->profile_path) {
+            profile_stop();
+            // Collapsed stacks for flame graphs, plus a summary on stderr
+            profile_write_folded(options->profile_path);
+            profile_print_top_lines(stderr, 20);
+            profile_free();
+        }
+    } else {
+        Chunk *chunk = compile(ast, resolution);
+        if (!chunk) {
+            ctx->failed = 1; // The node that could not be compiled has been reported
+            return 0;
+        }
+        if (options->disassemble) {
+            disassemble_chunk(chunk);
+        }
+        ok = run_chunk(ctx, chunk);
+        free_chunk(chunk);
+    }
+    return ok;
+}
 
-    Lexer *lexer = init_lexer(source);
-    ASTNode *root = parse(lexer);
+// Parse, check and run one program in `ctx`. Returns 1 if it ran to the
+// end. Errors in the source have been reported to ctx->diagnostics by the
+// time this returns; ctx->error says why the run failed, if there is more
+// to say.
+static int run_source(const Options *options, const char *source, size_t length, Context *ctx) {
+    Arena *arena = arena_create(); // Owns every string of the program
+    Lexer *lexer = init_lexer(source, length, arena);
+    lexer->diagnostics = ctx->diagnostics;
+    Ast *ast = parse(lexer);
+    int ok = 0;
 
-    if (root) {
-        printf("Parsed AST:\n");
-        print_ast_node(root, 0);
-        interpret(root);
-        free_ast(root);
+    if (ast) {
+        if (options->dump_ast) {
+            printf("Parsed AST:\n");
+            print_ast(ast);
+        }
+        Resolution *resolution = resolve(ast);
+        if (resolution) {
+            ok = run_program(options, ast, resolution, arena, ctx);
+            free_resolution(resolution);
+        } else {
+            ctx->failed = 1; // Each undefined variable has been reported
+        }
+        free_ast(ast);
     } else {
-        printf("Failed to parse source code.\n");
+        context_fail(ctx, "Failed to parse source code.");
+    }
+
+    free_lexer(lexer);
+    arena_destroy(arena);
+    return ok;
+}
+
+static int run_file(const Options *options, const char *path, Context *ctx) {
+    size_t length = 0;
+    char *source = map_source(ctx, path, &length);
+    if (!source) {
+        return 0;
     }
+    int ok = run_source(options, source, length, ctx);
+    unmap_source(source, length);
+    return ok;
+}
 
-    free(source);
-    free(lexer);
+// Batch mode runs many programs at once, one per job, on a pool of threads.
+// Each job prints into a buffer of its own; the main thread writes the
+// buffers out in the order the jobs were given as each one finishes, so the
+// output is the same however the jobs were scheduled. Errors in the source
+// are kept the same way and go to stderr after the job's output, each line
+// prefixed with the job's path.
+typedef struct {
+    const char *path;
+    Io io;            // Everything the program printed
+    Io diagnostics;   // Errors and warnings about the source, one per line
+    int ok;
+    char error[CONTEXT_ERROR_SIZE];
+    int done;
+} Job;
 
-    return 0;
+typedef struct {
+    const Options *options;
+    Job *jobs;
+    size_t count;
+    size_t next;      // Next job to start
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} Batch;
+
+static void run_job(const Options *options, Job *job) {
+    io_init(&job->io, IO_NONE, IO_NONE); // Keep the output; input() reads nothing
+    io_init(&job->diagnostics, IO_NONE, IO_NONE);
+    Context ctx;
+    context_init(&ctx, &job->io);
+    ctx.diagnostics = &job->diagnostics;
+    job->ok = run_file(options, job->path, &ctx);
+    memcpy(job->error, ctx.error, sizeof(job->error));
+    context_free(&ctx);
+}
+
+static void *batch_worker(void *argument) {
+    Batch *batch = argument;
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        size_t index = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        if (index >= batch->count) {
+            return NULL;
+        }
+        run_job(batch->options, &batch->jobs[index]);
+        pthread_mutex_lock(&batch->lock);
+        batch->jobs[index].done = 1;
+        pthread_cond_broadcast(&batch->finished);
+        pthread_mutex_unlock(&batch->lock);
+    }
+}
+
+// Write each line a job reported about its source to stderr, after its path
+static void report_diagnostics(const Job *job) {
+    const char *line = job->diagnostics.output;
+    const char *end = line + job->diagnostics.output_length;
+    while (line < end) {
+        const char *newline = memchr(line, '\n', (size_t)(end - line));
+        if (!newline) newline = end;
+        fprintf(stderr, "%s: %.*s\n", job->path, (int)(newline - line), line);
+        line = newline + 1;
+    }
+}
+
+// Run every job and write out the results. Returns the number that failed.
+static size_t run_batch(const Options *options, Job *jobs, size_t count, long threads) {
+    Batch batch = {options, jobs, count, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+    if (threads > (long)count) threads = (long)count;
+    pthread_t *workers = malloc(((size_t)threads + 1) * sizeof(pthread_t));
+    if (!workers) {
+        fprintf(stderr, "Out of memory starting the batch\n");
+        exit(1);
+    }
+    long started = 0;
+    while (started < threads && pthread_create(&workers[started], NULL, batch_worker, &batch) == 0) {
+        started++;
+    }
+    if (started == 0) {
+        batch_worker(&batch); // No threads to be had: run everything here
+    }
+
+    Io *out = io_standard();
+    size_t failures = 0;
+    for (size_t i = 0; i < count; i++) {
+        pthread_mutex_lock(&batch.lock);
+        while (!jobs[i].done) {
+            pthread_cond_wait(&batch.finished, &batch.lock);
+        }
+        pthread_mutex_unlock(&batch.lock);
+
+        io_write(out, "==> ", 4);
+        io_write(out, jobs[i].path, strlen(jobs[i].path));
+        io_write(out, " <==", 4);
+        io_newline(out);
+        io_write(out, jobs[i].io.output, jobs[i].io.output_length);
+        io_free(&jobs[i].io);
+        if (!jobs[i].ok || jobs[i].diagnostics.output_length > 0) {
+            io_flush(out); // Keep the job's errors next to the output they follow
+            report_diagnostics(&jobs[i]);
+        }
+        if (!jobs[i].ok) {
+            if (jobs[i].error[0] || jobs[i].diagnostics.output_length == 0) {
+                fprintf(stderr, "%s: %s\n", jobs[i].path, jobs[i].error[0] ? jobs[i].error : "failed");
+            }
+            failures++;
+        }
+        io_free(&jobs[i].diagnostics);
+    }
+
+    for (long i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    return failures;
+}
+
+// Paths of the programs to run in batch mode, one per line of standard input
+static size_t read_paths(char ***paths) {
+    size_t count = 0, capacity = 0;
+    char *line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+    *paths = NULL;
+    while ((length = getline(&line, &line_capacity, stdin)) >= 0) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        if (length == 0) continue;
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            *paths = realloc(*paths, capacity * sizeof(char*));
+        }
+        char *path = strdup(line);
+        if (!*paths || !path) {
+            fprintf(stderr, "Out of memory reading the batch\n");
+            exit(1);
+        }
+        (*paths)[count++] = path;
+    }
+    free(line);
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    Options options = {0};
+    options.optimize_ast = 1;
+    int batch = 0;
+    long threads = 0;
+    int threads_given = 0;
+    int tracing = 0;
+    const char **paths = malloc((size_t)argc * sizeof(char*));
+    size_t path_count = 0;
+    if (!paths) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tree") == 0) {
+            options.use_tree_walker = 1; // Reference mode: run the AST directly
+        } else if (strcmp(argv[i], "--disassemble") == 0) {
+            options.disassemble = 1;
+        } else if (strcmp(argv[i], "--dump-ast") == 0) {
+            options.dump_ast = 1;
+        } else if (strcmp(argv[i], "--no-optimize") == 0) {
+            options.optimize_ast = 0; // Run the tree exactly as parsed, for comparison
+        } else if (strcmp(argv[i], "--dump-optimized-ast") == 0) {
+            options.dump_optimized = 1;
+        } else if (strcmp(argv[i], "--ssa") == 0) {
+            options.use_ssa = 1; // Optimise through the SSA form as well
+        } else if (strcmp(argv[i], "--dump-ssa") == 0) {
+            options.use_ssa = 1;
+            options.dump_ssa = 1;
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            options.use_jit = 1; // Compile hot loops of the tree walker
+            options.use_tree_walker = 1;
+        } else if (strcmp(argv[i], "--emit-llvm") == 0) {
+            options.emit_llvm_ir = 1; // Compile ahead of time instead of running
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            options.profile_path = "profile.folded";
+            options.use_tree_walker = 1; // The profiler instruments AST nodes
+        } else if (strncmp(argv[i], "--profile=", 10) == 0) {
+            options.profile_path = argv[i] + 10;
+            options.use_tree_walker = 1;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = 1; // Run every file given, or listed on stdin, in parallel
+        } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            threads = atol(argv[i] + 7);
+            threads_given = 1;
+#ifdef CALC_TRACE
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            // Collect traces in memory and print them when the process exits
+            if (!trace_configure(argv[i] + 8)) {
+                fprintf(stderr, "Invalid trace spec: %s\n", argv[i] + 8);
+                return 1;
+            }
+            atexit(dump_trace_at_exit);
+            tracing = 1;
+#endif
+        } else {
+            paths[path_count++] = argv[i];
+        }
+    }
+    // A batch only runs programs: dumps would interleave, the profiler
+    // samples the whole process, and traces go to one ring shared without
+    // locking. --jobs= only means something to a batch.
+    int batch_options = !options.disassemble && !options.dump_ast && !options.dump_optimized &&
+                        !options.dump_ssa && !options.emit_llvm_ir && !options.profile_path && !tracing;
+    if (batch ? !batch_options : (path_count != 1 || threads_given)) {
+        fprintf(stderr, "Usage: %s [--tree] [--disassemble] [--dump-ast] [--no-optimize] [--dump-optimized-ast]"
+                " [--ssa] [--dump-ssa] [--emit-llvm] [--jit] [--profile[=<file>]]"
+#ifdef CALC_TRACE
+                " [--trace=<category>[:<level>],...]"
+#endif
+                " <source file>\n"
+                "       %s --batch [--jobs=<threads>] [--tree] [--jit] [--no-optimize] [--ssa]"
+                " [<source file>...]\n", argv[0], argv[0]);
+        free(paths);
+        return 1;
+    }
+
+    if (batch) {
+        char **listed = NULL;
+        size_t listed_count = 0;
+        if (path_count == 0) {
+            listed_count = read_paths(&listed);
+        }
+        size_t count = path_count ? path_count : listed_count;
+        Job *jobs = calloc(count + 1, sizeof(Job));
+        if (!jobs) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            jobs[i].path = path_count ? paths[i] : listed[i];
+        }
+        if (threads <= 0) {
+            threads = sysconf(_SC_NPROCESSORS_ONLN);
+            if (threads <= 0) threads = 1;
+        }
+        size_t failures = count ? run_batch(&options, jobs, count, threads) : 0;
+        for (size_t i = 0; i < listed_count; i++) {
+            free(listed[i]);
+        }
+        free(listed);
+        free(jobs);
+        free(paths);
+        return failures > 0;
+    }
+
+    Context ctx;
+    context_init(&ctx, io_standard());
+    int ok = run_file(&options, paths[0], &ctx);
+    if (!ok && ctx.error[0]) {
+        io_flush(ctx.io);
+        fprintf(stderr, "%s\n", ctx.error);
+    }
+    context_free(&ctx);
+    free(paths);
+    return !ok;
 }
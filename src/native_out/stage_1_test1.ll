@@ -0,0 +1,25 @@
+; Generated by --emit-llvm; link with the runtime library (runtime.h)
+
+declare i64 @calc_string(i8*) nounwind readnone
+declare i64 @calc_box_number(double) nounwind readnone
+declare i64 @calc_box_bool(i32) nounwind readnone
+declare i64 @calc_retain(i64) nounwind
+declare void @calc_release(i64) nounwind
+declare double @calc_number(i64) nounwind
+declare i32 @calc_truthy(i64) nounwind
+declare i64 @calc_add(i64, i64) nounwind
+declare i32 @calc_equal(i64, i64) nounwind
+declare void @calc_print_number(i8*, double) nounwind
+declare void @calc_print_bool(i8*, i32) nounwind
+declare void @calc_print_value(i8*, i64) nounwind
+declare i64 @calc_input(i64) nounwind
+declare void @calc_undefined(i8*) noreturn nounwind
+
+define i32 @main() {
+L0:
+  call void @calc_print_number(i8* getelementptr inbounds ([7 x i8], [7 x i8]* @label.Result, i64 0, i64 0), double 0xBFF0000000000000)
+  ret i32 0
+}
+
+@label.Print = private unnamed_addr constant [6 x i8] c"Print\00"
+@label.Result = private unnamed_addr constant [7 x i8] c"Result\00"
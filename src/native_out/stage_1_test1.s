@@ -0,0 +1,29 @@
+	.text
+	.file	"stage_1_test1.ll"
+	.section	.rodata.cst8,"aM",@progbits,8
+	.p2align	3                               # -- Begin function main
+.LCPI0_0:
+	.quad	0xbff0000000000000              # double -1
+	.text
+	.globl	main
+	.p2align	4, 0x90
+	.type	main,@function
+main:                                   # @main
+# %bb.0:                                # %L0
+	pushq	%rax
+	leaq	.Llabel.Result(%rip), %rdi
+	movsd	.LCPI0_0(%rip), %xmm0           # xmm0 = mem[0],zero
+	callq	calc_print_number@PLT
+	xorl	%eax, %eax
+	popq	%rcx
+	retq
+.Lfunc_end0:
+	.size	main, .Lfunc_end0-main
+                                        # -- End function
+	.type	.Llabel.Result,@object          # @label.Result
+	.section	.rodata.str1.1,"aMS",@progbits,1
+.Llabel.Result:
+	.asciz	"Result"
+	.size	.Llabel.Result, 7
+
+	.section	".note.GNU-stack","",@progbits
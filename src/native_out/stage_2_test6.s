@@ -0,0 +1,28 @@
+	.text
+	.file	"stage_2_test6.ll"
+	.globl	main                            # -- Begin function main
+	.p2align	4, 0x90
+	.type	main,@function
+main:                                   # @main
+# %bb.0:                                # %L0
+	pushq	%rbx
+	leaq	.Llabel.Result(%rip), %rbx
+	movq	%rbx, %rdi
+	xorl	%esi, %esi
+	callq	calc_print_bool@PLT
+	movq	%rbx, %rdi
+	movl	$1, %esi
+	callq	calc_print_bool@PLT
+	xorl	%eax, %eax
+	popq	%rbx
+	retq
+.Lfunc_end0:
+	.size	main, .Lfunc_end0-main
+                                        # -- End function
+	.type	.Llabel.Result,@object          # @label.Result
+	.section	.rodata.str1.1,"aMS",@progbits,1
+.Llabel.Result:
+	.asciz	"Result"
+	.size	.Llabel.Result, 7
+
+	.section	".note.GNU-stack","",@progbits
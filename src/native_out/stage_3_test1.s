@@ -0,0 +1,31 @@
+	.text
+	.file	"stage_3_test1.ll"
+	.globl	main                            # -- Begin function main
+	.p2align	4, 0x90
+	.type	main,@function
+main:                                   # @main
+# %bb.0:                                # %L0
+	pushq	%rax
+	leaq	.Lstring.4(%rip), %rdi
+	callq	calc_string@PLT
+	leaq	.Llabel.Result(%rip), %rdi
+	movq	%rax, %rsi
+	callq	calc_print_value@PLT
+	xorl	%eax, %eax
+	popq	%rcx
+	retq
+.Lfunc_end0:
+	.size	main, .Lfunc_end0-main
+                                        # -- End function
+	.type	.Llabel.Result,@object          # @label.Result
+	.section	.rodata.str1.1,"aMS",@progbits,1
+.Llabel.Result:
+	.asciz	"Result"
+	.size	.Llabel.Result, 7
+
+	.type	.Lstring.4,@object              # @string.4
+.Lstring.4:
+	.asciz	"hello world"
+	.size	.Lstring.4, 12
+
+	.section	".note.GNU-stack","",@progbits
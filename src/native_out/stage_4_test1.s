@@ -0,0 +1,29 @@
+	.text
+	.file	"stage_4_test1.ll"
+	.section	.rodata.cst8,"aM",@progbits,8
+	.p2align	3                               # -- Begin function main
+.LCPI0_0:
+	.quad	0x4018000000000000              # double 6
+	.text
+	.globl	main
+	.p2align	4, 0x90
+	.type	main,@function
+main:                                   # @main
+# %bb.0:                                # %L0
+	pushq	%rax
+	leaq	.Llabel.Print(%rip), %rdi
+	movsd	.LCPI0_0(%rip), %xmm0           # xmm0 = mem[0],zero
+	callq	calc_print_number@PLT
+	xorl	%eax, %eax
+	popq	%rcx
+	retq
+.Lfunc_end0:
+	.size	main, .Lfunc_end0-main
+                                        # -- End function
+	.type	.Llabel.Print,@object           # @label.Print
+	.section	.rodata.str1.1,"aMS",@progbits,1
+.Llabel.Print:
+	.asciz	"Print"
+	.size	.Llabel.Print, 6
+
+	.section	".note.GNU-stack","",@progbits
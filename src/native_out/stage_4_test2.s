@@ -0,0 +1,67 @@
+	.text
+	.file	"stage_4_test2.ll"
+	.section	.rodata.cst8,"aM",@progbits,8
+	.p2align	3                               # -- Begin function main
+.LCPI0_0:
+	.quad	0x4014000000000000              # double 5
+	.text
+	.globl	main
+	.p2align	4, 0x90
+	.type	main,@function
+main:                                   # @main
+# %bb.0:                                # %L0
+	pushq	%r14
+	pushq	%rbx
+	pushq	%rax
+	leaq	.Lstring.0(%rip), %rdi
+	callq	calc_string@PLT
+	movq	%rax, %r14
+	movq	%rax, %rdi
+	callq	calc_retain@PLT
+	movq	%rax, %rbx
+	movsd	.LCPI0_0(%rip), %xmm0           # xmm0 = mem[0],zero
+	callq	calc_box_number@PLT
+	movq	%rbx, %rdi
+	movq	%rax, %rsi
+	callq	calc_add@PLT
+	movq	%rax, %rbx
+	leaq	.Lstring.3(%rip), %rdi
+	callq	calc_string@PLT
+	movq	%rbx, %rdi
+	movq	%rax, %rsi
+	callq	calc_add@PLT
+	movq	%rax, %rbx
+	movq	%r14, %rdi
+	callq	calc_release@PLT
+	movq	%rbx, %rdi
+	callq	calc_retain@PLT
+	leaq	.Llabel.Print(%rip), %rdi
+	movq	%rax, %rsi
+	callq	calc_print_value@PLT
+	movq	%rbx, %rdi
+	callq	calc_release@PLT
+	xorl	%eax, %eax
+	addq	$8, %rsp
+	popq	%rbx
+	popq	%r14
+	retq
+.Lfunc_end0:
+	.size	main, .Lfunc_end0-main
+                                        # -- End function
+	.type	.Llabel.Print,@object           # @label.Print
+	.section	.rodata.str1.1,"aMS",@progbits,1
+.Llabel.Print:
+	.asciz	"Print"
+	.size	.Llabel.Print, 6
+
+	.type	.Lstring.0,@object              # @string.0
+.Lstring.0:
+	.asciz	"10 corgis "
+	.size	.Lstring.0, 11
+
+	.type	.Lstring.3,@object              # @string.3
+.Lstring.3:
+	.asciz	" more corgis"
+	.size	.Lstring.3, 13
+
+	.section	".note.GNU-stack","",@progbits
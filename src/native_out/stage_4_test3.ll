@@ -0,0 +1,33 @@
+; Generated by --emit-llvm; link with the runtime library (runtime.h)
+
+declare i64 @calc_string(i8*) nounwind readnone
+declare i64 @calc_box_number(double) nounwind readnone
+declare i64 @calc_box_bool(i32) nounwind readnone
+declare i64 @calc_retain(i64) nounwind
+declare void @calc_release(i64) nounwind
+declare double @calc_number(i64) nounwind
+declare i32 @calc_truthy(i64) nounwind
+declare i64 @calc_add(i64, i64) nounwind
+declare i32 @calc_equal(i64, i64) nounwind
+declare void @calc_print_number(i8*, double) nounwind
+declare void @calc_print_bool(i8*, i32) nounwind
+declare void @calc_print_value(i8*, i64) nounwind
+declare i64 @calc_input(i64) nounwind
+declare void @calc_undefined(i8*) noreturn nounwind
+
+define i32 @main() {
+L0:
+  %t0 = call i64 @calc_box_number(double 0x4014000000000000)
+  %t1 = call i64 @calc_retain(i64 %t0)
+  %t2 = call i64 @calc_string(i8* getelementptr inbounds ([20 x i8], [20 x i8]* @string.2, i64 0, i64 0))
+  %t3 = call i64 @calc_add(i64 %t1, i64 %t2)
+  call void @calc_release(i64 %t0)
+  %t4 = call i64 @calc_retain(i64 %t3)
+  call void @calc_print_value(i8* getelementptr inbounds ([6 x i8], [6 x i8]* @label.Print, i64 0, i64 0), i64 %t4)
+  call void @calc_release(i64 %t3)
+  ret i32 0
+}
+
+@label.Print = private unnamed_addr constant [6 x i8] c"Print\00"
+@label.Result = private unnamed_addr constant [7 x i8] c"Result\00"
+@string.2 = private unnamed_addr constant [20 x i8] c" insert string here\00"
@@ -0,0 +1,58 @@
+	.text
+	.file	"stage_4_test3.ll"
+	.section	.rodata.cst8,"aM",@progbits,8
+	.p2align	3                               # -- Begin function main
+.LCPI0_0:
+	.quad	0x4014000000000000              # double 5
+	.text
+	.globl	main
+	.p2align	4, 0x90
+	.type	main,@function
+main:                                   # @main
+# %bb.0:                                # %L0
+	pushq	%r15
+	pushq	%r14
+	pushq	%rbx
+	movsd	.LCPI0_0(%rip), %xmm0           # xmm0 = mem[0],zero
+	callq	calc_box_number@PLT
+	movq	%rax, %r15
+	movq	%rax, %rdi
+	callq	calc_retain@PLT
+	movq	%rax, %r14
+	leaq	.Lstring.2(%rip), %rdi
+	callq	calc_string@PLT
+	movq	%r14, %rdi
+	movq	%rax, %rsi
+	callq	calc_add@PLT
+	movq	%rax, %rbx
+	movq	%r15, %rdi
+	callq	calc_release@PLT
+	movq	%rbx, %rdi
+	callq	calc_retain@PLT
+	leaq	.Llabel.Print(%rip), %rdi
+	movq	%rax, %rsi
+	callq	calc_print_value@PLT
+	movq	%rbx, %rdi
+	callq	calc_release@PLT
+	xorl	%eax, %eax
+	popq	%rbx
+	popq	%r14
+	popq	%r15
+	retq
+.Lfunc_end0:
+	.size	main, .Lfunc_end0-main
+                                        # -- End function
+	.type	.Llabel.Print,@object           # @label.Print
+	.section	.rodata.str1.1,"aMS",@progbits,1
+.Llabel.Print:
+	.asciz	"Print"
+	.size	.Llabel.Print, 6
+
+	.type	.Lstring.2,@object              # @string.2
+	.section	.rodata.str1.16,"aMS",@progbits,1
+	.p2align	4
+.Lstring.2:
+	.asciz	" insert string here"
+	.size	.Lstring.2, 20
+
+	.section	".note.GNU-stack","",@progbits
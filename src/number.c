@@ -0,0 +1,107 @@
+#include "number.h"
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Both directions lean on the same fact (Clinger's fast path): an integer of
+// at most 53 bits and a power of ten up to 10^22 are exact doubles, so one
+// multiplication or division of them is correctly rounded. That covers the
+// literals and results of nearly every program; anything else goes through
+// the C library, which is exact but slower.
+
+#define MAX_EXACT_INTEGER 9007199254740992.0 // 2^53
+#define MAX_EXACT_POWER 22
+#define MAX_FRACTION_DIGITS 17 // More than this is written with an exponent
+
+static const double powers_of_ten[MAX_EXACT_POWER + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static double parse_with_strtod(const char *chars, size_t length) {
+    char small[64];
+    char *copy = length < sizeof(small) ? small : malloc(length + 1);
+    if (!copy) {
+        fprintf(stderr, "Out of memory while reading a number\n");
+        exit(1);
+    }
+    memcpy(copy, chars, length);
+    copy[length] = '\0';
+    double value = strtod(copy, NULL);
+    if (copy != small) free(copy);
+    return value;
+}
+
+double parse_decimal(const char *chars, size_t length) {
+    uint64_t mantissa = 0;
+    int exponent = 0;  // Power of ten the mantissa is scaled by
+    int fraction = 0;  // Past the '.'
+    for (size_t i = 0; i < length; i++) {
+        if (chars[i] == '.') {
+            fraction = 1;
+            continue;
+        }
+        if (mantissa >= (UINT64_MAX - 9) / 10) {
+            return parse_with_strtod(chars, length); // Too many digits to hold
+        }
+        mantissa = mantissa * 10 + (uint64_t)(chars[i] - '0');
+        exponent -= fraction;
+    }
+    if (mantissa > (uint64_t)MAX_EXACT_INTEGER || -exponent > MAX_EXACT_POWER) {
+        return parse_with_strtod(chars, length);
+    }
+    return (double)mantissa / powers_of_ten[-exponent];
+}
+
+// Write `digits`, an integer below 2^53, with `point` of its digits after a
+// decimal point
+static size_t write_fixed(char *buffer, int negative, uint64_t digits, int point) {
+    char reversed[24];
+    int count = 0;
+    do {
+        reversed[count++] = (char)('0' + digits % 10);
+        digits /= 10;
+    } while (digits > 0);
+    while (count <= point) {
+        reversed[count++] = '0'; // Leading zeros of a fraction, as in 0.05
+    }
+
+    size_t length = 0;
+    if (negative) buffer[length++] = '-';
+    while (count > 0) {
+        if (count == point) buffer[length++] = '.';
+        buffer[length++] = reversed[--count];
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+size_t format_number(double number, char *buffer) {
+    if (isfinite(number)) {
+        // The fewest fraction digits whose decimal reads back as `number`.
+        // Reading n / 10^k is a single correctly rounded division, so
+        // comparing that division with `number` is an exact round-trip test.
+        double magnitude = fabs(number);
+        for (int point = 0; point <= MAX_FRACTION_DIGITS; point++) {
+            double scaled = nearbyint(magnitude * powers_of_ten[point]);
+            if (scaled >= MAX_EXACT_INTEGER) break;
+            if (scaled / powers_of_ten[point] == magnitude) {
+                return write_fixed(buffer, signbit(number) != 0, (uint64_t)scaled, point);
+            }
+        }
+    }
+
+    // Very large, very small or 17 significant digits: the shortest %g that
+    // reads back. When fewer than 16 digits would do, %.15g already rounds
+    // to them and drops the zeros after, except for subnormals, whose ulp
+    // is coarser than 15 digits.
+    int length = 0;
+    for (int precision = fabs(number) < DBL_MIN ? 1 : 15; precision <= 17; precision++) {
+        length = snprintf(buffer, NUMBER_BUFFER_SIZE, "%.*g", precision, number);
+        if (!isfinite(number) || strtod(buffer, NULL) == number) break;
+    }
+    return (size_t)length;
+}
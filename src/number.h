@@ -0,0 +1,21 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <stddef.h>
+
+// Conversions between doubles and decimal text, both exact: a literal reads
+// as the double nearest to it, and a number is written with the fewest
+// digits that read back as the same double ("6", "0.1", "3.3333333333333335").
+
+// Longest text format_number() writes, including the terminating NUL
+#define NUMBER_BUFFER_SIZE 32
+
+// Value of a decimal literal of digits with at most one '.', which need not
+// be NUL-terminated
+double parse_decimal(const char *chars, size_t length);
+
+// Write the shortest round-tripping text of `number` to `buffer`, which must
+// hold NUMBER_BUFFER_SIZE bytes. Returns its length; the text is NUL-terminated.
+size_t format_number(double number, char *buffer);
+
+#endif // NUMBER_H
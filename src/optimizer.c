@@ -0,0 +1,283 @@
+#include "optimizer.h"
+#include "interpreter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Folding reuses the interpreter's value helpers, so constant results follow
+// exactly the casting rules used at run time. Only literal operands of the
+// types an operator is defined on are folded; anything the interpreter would
+// compute from the wrong union member is left for run time.
+
+static int is_literal(Ast *ast, NodeId node) {
+    if (node == AST_NONE) return 0;
+    TokenType kind = ast_kind(ast, node);
+    return kind == TOKEN_NUMBER || kind == TOKEN_STRING || kind == TOKEN_TRUE || kind == TOKEN_FALSE;
+}
+
+static int is_number(Ast *ast, NodeId node) {
+    return node != AST_NONE && ast_kind(ast, node) == TOKEN_NUMBER;
+}
+
+static int is_bool(Ast *ast, NodeId node) {
+    return node != AST_NONE && (ast_kind(ast, node) == TOKEN_TRUE || ast_kind(ast, node) == TOKEN_FALSE);
+}
+
+// Node kinds that always evaluate to VAL_NUMBER
+static int yields_number(Ast *ast, NodeId node) {
+    switch (ast_kind(ast, node)) {
+        case TOKEN_NUMBER: case TOKEN_MINUS: case TOKEN_MUL: case TOKEN_DIV:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Node kinds that always evaluate to VAL_BOOL
+static int yields_bool(Ast *ast, NodeId node) {
+    switch (ast_kind(ast, node)) {
+        case TOKEN_TRUE: case TOKEN_FALSE: case TOKEN_NOT: case TOKEN_AND: case TOKEN_OR:
+        case TOKEN_EQ: case TOKEN_NEQ: case TOKEN_LT: case TOKEN_GT: case TOKEN_LTE: case TOKEN_GTE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static Value literal_value(Ast *ast, NodeId node) {
+    switch (ast_kind(ast, node)) {
+        case TOKEN_STRING:
+            return STRING_VAL(ast_name(ast, node));
+        case TOKEN_TRUE:
+        case TOKEN_FALSE:
+            return BOOL_VAL(ast_kind(ast, node) == TOKEN_TRUE);
+        default:
+            return NUMBER_VAL(ast_number(ast, node));
+    }
+}
+
+// Rewrite a node in place into a literal, keeping its line
+static NodeId make_number(Ast *ast, NodeId node, double number) {
+    ast_set_number(ast, node, number);
+    ast->left[node] = ast->right[node] = AST_NONE;
+    return node;
+}
+
+static NodeId make_bool(Ast *ast, NodeId node, int boolean) {
+    ast->kinds[node] = boolean ? TOKEN_TRUE : TOKEN_FALSE;
+    ast->left[node] = ast->right[node] = AST_NONE;
+    return node;
+}
+
+static NodeId make_string(Ast *ast, NodeId node, Arena *arena, Value value) {
+    char scratch[NUMBER_BUFFER_SIZE];
+    size_t length;
+    const char *chars = value_chars(value, &length, scratch);
+    ast->kinds[node] = TOKEN_STRING;
+    ast_set_name(ast, node, arena_strndup(arena, chars, length));
+    ast->left[node] = ast->right[node] = AST_NONE;
+    return node;
+}
+
+// Fold one operator whose operands have been folded already. Returns the
+// node, rewritten into a literal if it was constant, or the operand an
+// identity reduces it to.
+static NodeId fold_node(Ast *ast, NodeId node, Arena *arena) {
+    NodeId left = ast->left[node], right = ast->right[node];
+    TokenType kind = ast_kind(ast, node);
+
+    switch (kind) {
+        case TOKEN_PLUS:
+            if (is_literal(ast, left) && is_literal(ast, right) &&
+                (ast_kind(ast, left) == TOKEN_STRING || ast_kind(ast, right) == TOKEN_STRING)) {
+                Value joined = concatenate_values(literal_value(ast, left), literal_value(ast, right));
+                make_string(ast, node, arena, joined);
+                value_release(joined);
+            } else if (is_number(ast, left) && is_number(ast, right)) {
+                make_number(ast, node, ast_number(ast, left) + ast_number(ast, right));
+            }
+            // x + 0 is not folded: it turns -0 into 0, and concatenates when x is a string
+            return node;
+        case TOKEN_MINUS:
+            if (left == AST_NONE) {
+                if (is_number(ast, right)) return make_number(ast, node, -ast_number(ast, right));
+                if (ast_kind(ast, right) == TOKEN_MINUS && ast->left[right] == AST_NONE &&
+                    yields_number(ast, ast->right[right])) {
+                    return ast->right[right]; // -(-x)
+                }
+                return node;
+            }
+            if (is_number(ast, left) && is_number(ast, right)) {
+                return make_number(ast, node, ast_number(ast, left) - ast_number(ast, right));
+            }
+            if (is_number(ast, right) && ast_number(ast, right) == 0 && yields_number(ast, left)) return left; // x - 0
+            return node;
+        case TOKEN_MUL:
+            if (is_number(ast, left) && is_number(ast, right)) {
+                return make_number(ast, node, ast_number(ast, left) * ast_number(ast, right));
+            }
+            if (is_number(ast, right) && ast_number(ast, right) == 1 && yields_number(ast, left)) return left; // x * 1
+            if (is_number(ast, left) && ast_number(ast, left) == 1 && yields_number(ast, right)) return right; // 1 * x
+            return node;
+        case TOKEN_DIV:
+            if (is_number(ast, left) && is_number(ast, right)) {
+                return make_number(ast, node, ast_number(ast, left) / ast_number(ast, right));
+            }
+            if (is_number(ast, right) && ast_number(ast, right) == 1 && yields_number(ast, left)) return left; // x / 1
+            return node;
+        case TOKEN_EQ:
+        case TOKEN_NEQ:
+            if (is_literal(ast, left) && is_literal(ast, right)) {
+                int equal = values_equal(literal_value(ast, left), literal_value(ast, right));
+                return make_bool(ast, node, kind == TOKEN_EQ ? equal : !equal);
+            }
+            return node;
+        case TOKEN_LT:
+            if (is_number(ast, left) && is_number(ast, right)) {
+                return make_bool(ast, node, ast_number(ast, left) < ast_number(ast, right));
+            }
+            return node;
+        case TOKEN_GT:
+            if (is_number(ast, left) && is_number(ast, right)) {
+                return make_bool(ast, node, ast_number(ast, left) > ast_number(ast, right));
+            }
+            return node;
+        case TOKEN_LTE:
+            if (is_number(ast, left) && is_number(ast, right)) {
+                return make_bool(ast, node, ast_number(ast, left) <= ast_number(ast, right));
+            }
+            return node;
+        case TOKEN_GTE:
+            if (is_number(ast, left) && is_number(ast, right)) {
+                return make_bool(ast, node, ast_number(ast, left) >= ast_number(ast, right));
+            }
+            return node;
+        case TOKEN_AND:
+            if (ast_kind(ast, left) == TOKEN_FALSE) return make_bool(ast, node, 0); // Short-circuits
+            if (ast_kind(ast, left) == TOKEN_TRUE) {
+                if (is_bool(ast, right)) return make_bool(ast, node, ast_kind(ast, right) == TOKEN_TRUE);
+                if (yields_bool(ast, right)) return right; // true && x
+            }
+            return node;
+        case TOKEN_OR:
+            if (ast_kind(ast, left) == TOKEN_TRUE) return make_bool(ast, node, 1);
+            if (ast_kind(ast, left) == TOKEN_FALSE) {
+                if (is_bool(ast, right)) return make_bool(ast, node, ast_kind(ast, right) == TOKEN_TRUE);
+                if (yields_bool(ast, right)) return right; // false || x
+            }
+            return node;
+        case TOKEN_NOT:
+            if (is_bool(ast, right)) return make_bool(ast, node, ast_kind(ast, right) == TOKEN_FALSE);
+            if (ast_kind(ast, right) == TOKEN_NOT && yields_bool(ast, ast->right[right])) {
+                return ast->right[right]; // !!x
+            }
+            return node;
+        default:
+            return node;
+    }
+}
+
+// An operator waiting for its operands to be folded; index counts the
+// operands done
+typedef struct {
+    NodeId node;
+    uint32_t index;
+} FoldFrame;
+
+typedef struct {
+    Ast *ast;
+    Arena *arena;
+    FoldFrame *frames;
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+} Folder;
+
+// Fold an expression bottom up. Operators wait in frames on the heap while
+// their operands are folded, so nesting depth costs no native stack.
+static NodeId fold_expression(Folder *f, NodeId node) {
+    Ast *ast = f->ast;
+    for (;;) {
+        // Go down the left operands, leaving a frame for each operator
+        while (node != AST_NONE && (ast->left[node] != AST_NONE || ast->right[node] != AST_NONE)) {
+            if (f->frame_count == f->frame_capacity) {
+                f->frame_capacity = f->frame_capacity ? f->frame_capacity * 2 : 64;
+                f->frames = realloc(f->frames, f->frame_capacity * sizeof(FoldFrame));
+                if (!f->frames) {
+                    fprintf(stderr, "Out of memory while optimizing\n");
+                    exit(1);
+                }
+            }
+            f->frames[f->frame_count++] = (FoldFrame){node, 0};
+            node = ast->left[node];
+        }
+        if (node != AST_NONE) {
+            node = fold_node(ast, node, f->arena);
+        }
+        // Hand the folded operand to its operator, folding every operator
+        // that is complete, until one still has a right operand to fold
+        for (;;) {
+            if (f->frame_count == 0) return node;
+            FoldFrame *frame = &f->frames[f->frame_count - 1];
+            if (frame->index++ == 0) {
+                ast->left[frame->node] = node;
+                node = ast->right[frame->node];
+                break;
+            }
+            ast->right[frame->node] = node;
+            f->frame_count--;
+            node = fold_node(ast, frame->node, f->arena);
+        }
+    }
+}
+
+static void optimize_statements(Folder *f, NodeId block);
+
+// Optimise one statement, returning its replacement or AST_NONE to drop it
+static NodeId optimize_statement(Folder *f, NodeId node) {
+    Ast *ast = f->ast;
+    switch (ast_kind(ast, node)) {
+        case TOKEN_PRINT:
+        case TOKEN_ASSIGN:
+            ast->left[node] = fold_expression(f, ast->left[node]);
+            return node;
+        case TOKEN_WHILE:
+            ast->left[node] = fold_expression(f, ast->left[node]);
+            if (ast->left[node] != AST_NONE && ast_kind(ast, ast->left[node]) == TOKEN_FALSE) {
+                return AST_NONE; // The body can never run
+            }
+            optimize_statements(f, ast->right[node]);
+            return node;
+        case TOKEN_LBRACE:
+            optimize_statements(f, node);
+            return node;
+        default:
+            if (is_result_expression(ast_kind(ast, node))) {
+                // An identity may reduce the statement to a bare variable,
+                // which would stop it being echoed; keep the root then
+                NodeId folded = fold_expression(f, node);
+                if (folded != node && is_result_expression(ast_kind(ast, folded))) {
+                    return folded;
+                }
+            }
+            return node;
+    }
+}
+
+// Optimise the statements of a block, compacting its list in place
+static void optimize_statements(Folder *f, NodeId block) {
+    Ast *ast = f->ast;
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < ast_statement_count(ast, block); i++) {
+        NodeId statement = optimize_statement(f, ast_statements(ast, block)[i]);
+        if (statement != AST_NONE) {
+            ast_statements(ast, block)[kept++] = statement;
+        }
+    }
+    ast->right[block] = kept;
+}
+
+void optimize(Ast *ast, Arena *arena) {
+    Folder f = {ast, arena, NULL, 0, 0};
+    optimize_statements(&f, ast->root);
+    free(f.frames);
+}
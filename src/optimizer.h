@@ -0,0 +1,13 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "parser.h"
+#include "arena.h"
+
+// Fold constant subexpressions, apply algebraic identities that cannot
+// change a result, and drop loops whose condition is constantly false.
+// Runs on a resolved program and rewrites it in place; folded strings are
+// allocated from `arena`.
+void optimize(Ast *ast, Arena *arena);
+
+#endif // OPTIMIZER_H
@@ -1,285 +1,435 @@
 #include "parser.h"
+#include "trace.h"
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
-// Utility function to print AST nodes
-void print_ast_node(ASTNode *node, int depth) {
-    if (!node) return;
-    for (int i = 0; i < depth; i++) printf("  ");
-    printf("ASTNode: type=%d, value=%f, name=%s\n", node->type, node->value, node->name ? node->name : "NULL");
-    print_ast_node(node->left, depth + 1);
-    print_ast_node(node->right, depth + 1);
-    print_ast_node(node->condition, depth + 1);
-    print_ast_node(node->body, depth + 1);
-    print_ast_node(node->else_body, depth + 1);
-    print_ast_node(node->next, depth + 1);
+static void *resize_array(void *array, uint32_t capacity, size_t element_size) {
+    array = realloc(array, (size_t)capacity * element_size);
+    if (!array) {
+        fprintf(stderr, "Out of memory while building the AST\n");
+        exit(1);
+    }
+    return array;
 }
 
-// Parse a factor (number, string, boolean, or parenthesized expression)
-ASTNode* factor(Lexer *lexer) {
-    Token token = lexer->current_token;
-    if (token.type == TOKEN_NUMBER) {
-        lexer_advance(lexer);
-        return init_ast_node(TOKEN_NUMBER, token.value, NULL);
-    } else if (token.type == TOKEN_STRING) {
-        lexer_advance(lexer);
-        return init_ast_node(TOKEN_STRING, 0, token.name); // Use token.name
-    } else if (token.type == TOKEN_TRUE || token.type == TOKEN_FALSE) {
-        lexer_advance(lexer);
-        return init_ast_node(token.type, token.type == TOKEN_TRUE ? 1 : 0, NULL);
-    } else if (token.type == TOKEN_LPAREN) {
-        lexer_advance(lexer);
-        ASTNode *node = parse_expression(lexer);
-        if (lexer->current_token.type == TOKEN_RPAREN) {
-            lexer_advance(lexer);
-        } else {
-            printf("Error: unmatched parenthesis\n");
-            exit(1);
-        }
-        return node;
-    } else if (token.type == TOKEN_MINUS || token.type == TOKEN_NOT) {
-        lexer_advance(lexer);
-        ASTNode *node = init_ast_node(token.type, 0, NULL);
-        node->right = factor(lexer); // Handle unary operators
-        return node;
-    } else if (token.type == TOKEN_IDENTIFIER) {
-        lexer_advance(lexer);
-        return init_ast_node(TOKEN_IDENTIFIER, 0, token.name); // Use token.name
+static void *grow_array(void *array, uint32_t *capacity, size_t element_size) {
+    *capacity = *capacity ? *capacity * 2 : 256;
+    return resize_array(array, *capacity, element_size);
+}
+
+Ast* ast_create(void) {
+    Ast *ast = calloc(1, sizeof(Ast));
+    if (!ast) {
+        fprintf(stderr, "Out of memory while building the AST\n");
+        exit(1);
     }
-    printf("Error: unknown factor: %d\n", token.type); // Debug: unknown factor
-    exit(1);
-    return NULL;
+    ast_add_node(ast, TOKEN_EOF, AST_NONE, AST_NONE, 0); // Reserve AST_NONE
+    return ast;
 }
 
-// Parse a term (multiplication and division)
-ASTNode* term(Lexer *lexer) {
-    ASTNode *node = factor(lexer);
-    while (lexer->current_token.type == TOKEN_MUL || lexer->current_token.type == TOKEN_DIV) {
-        Token token = lexer->current_token;
-        lexer_advance(lexer);
-        ASTNode *new_node = init_ast_node(token.type, 0, NULL);
-        new_node->left = node;
-        new_node->right = factor(lexer);
-        node = new_node;
+void free_ast(Ast *ast) {
+    if (!ast) return;
+    free(ast->kinds);
+    free(ast->flags);
+    free(ast->left);
+    free(ast->right);
+    free(ast->data);
+    free(ast->slots);
+    free(ast->lines);
+    free(ast->types);
+    free(ast->numbers);
+    free(ast->names);
+    free(ast->children);
+    free(ast);
+}
+
+// Append a node with no payload; the columns all share one capacity
+NodeId ast_add_node(Ast *ast, TokenType kind, NodeId left, NodeId right, int line) {
+    if (ast->count == ast->capacity) {
+        uint32_t capacity = ast->capacity ? ast->capacity * 2 : 256;
+        ast->kinds = resize_array(ast->kinds, capacity, sizeof(uint8_t));
+        ast->flags = resize_array(ast->flags, capacity, sizeof(uint8_t));
+        ast->left = resize_array(ast->left, capacity, sizeof(NodeId));
+        ast->right = resize_array(ast->right, capacity, sizeof(NodeId));
+        ast->data = resize_array(ast->data, capacity, sizeof(uint32_t));
+        ast->slots = resize_array(ast->slots, capacity, sizeof(int32_t));
+        ast->lines = resize_array(ast->lines, capacity, sizeof(int32_t));
+        ast->capacity = capacity;
     }
+    NodeId node = ast->count++;
+    ast->kinds[node] = (uint8_t)kind;
+    ast->flags[node] = 0;
+    ast->left[node] = left;
+    ast->right[node] = right;
+    ast->data[node] = 0;
+    ast->slots[node] = -1;
+    ast->lines[node] = line;
     return node;
 }
 
-// Parse an arithmetic expression (addition, subtraction, and string concatenation)
-ASTNode* arithmetic_expression(Lexer *lexer) {
-    ASTNode *node = term(lexer);
-    while (lexer->current_token.type == TOKEN_PLUS || lexer->current_token.type == TOKEN_MINUS) {
-        Token token = lexer->current_token;
-        lexer_advance(lexer);
-        ASTNode *new_node = init_ast_node(token.type, 0, NULL);
-        new_node->left = node;
-        new_node->right = term(lexer);
-        node = new_node;
+// Point a node at a new number, turning it into a TOKEN_NUMBER literal
+void ast_set_number(Ast *ast, NodeId node, double value) {
+    if (ast->number_count == ast->number_capacity) {
+        ast->numbers = grow_array(ast->numbers, &ast->number_capacity, sizeof(double));
     }
-    return node;
+    ast->numbers[ast->number_count] = value;
+    ast->kinds[node] = TOKEN_NUMBER;
+    ast->data[node] = ast->number_count++;
 }
 
-// Parse a comparison expression
-ASTNode* comparison(Lexer *lexer) {
-    ASTNode *node = arithmetic_expression(lexer);
-    while (lexer->current_token.type == TOKEN_LT || lexer->current_token.type == TOKEN_GT ||
-           lexer->current_token.type == TOKEN_LTE || lexer->current_token.type == TOKEN_GTE) {
-        Token token = lexer->current_token;
-        lexer_advance(lexer);
-        ASTNode *new_node = init_ast_node(token.type, 0, NULL);
-        new_node->left = node;
-        new_node->right = arithmetic_expression(lexer);
-        node = new_node;
+void ast_set_name(Ast *ast, NodeId node, char *name) {
+    if (ast->name_count == ast->name_capacity) {
+        ast->names = grow_array(ast->names, &ast->name_capacity, sizeof(char*));
     }
+    ast->names[ast->name_count] = name;
+    ast->data[node] = ast->name_count++;
+}
+
+NodeId ast_add_number(Ast *ast, double value, int line) {
+    NodeId node = ast_add_node(ast, TOKEN_NUMBER, AST_NONE, AST_NONE, line);
+    ast_set_number(ast, node, value);
     return node;
 }
 
-// Parse an equality expression
-ASTNode* equality(Lexer *lexer) {
-    ASTNode *node = comparison(lexer);
-    while (lexer->current_token.type == TOKEN_EQ || lexer->current_token.type == TOKEN_NEQ) {
-        Token token = lexer->current_token;
-        lexer_advance(lexer);
-        ASTNode *new_node = init_ast_node(token.type, 0, NULL);
-        new_node->left = node;
-        new_node->right = comparison(lexer);
-        node = new_node;
-    }
+// String literal, identifier or assignment
+NodeId ast_add_named(Ast *ast, TokenType kind, char *name, NodeId left, int line) {
+    NodeId node = ast_add_node(ast, kind, left, AST_NONE, line);
+    ast_set_name(ast, node, name);
     return node;
 }
 
-// Parse a logical AND expression
-ASTNode* logical_and(Lexer *lexer) {
-    ASTNode *node = equality(lexer);
-    while (lexer->current_token.type == TOKEN_AND) {
-        Token token = lexer->current_token;
-        lexer_advance(lexer);
-        ASTNode *new_node = init_ast_node(token.type, 0, NULL);
-        new_node->left = node;
-        new_node->right = equality(lexer);
-        node = new_node;
+// Copy a finished statement list into one contiguous run of children
+NodeId ast_add_block(Ast *ast, const NodeId *statements, uint32_t count, int line) {
+    while (ast->child_capacity - ast->child_count < count) {
+        ast->children = grow_array(ast->children, &ast->child_capacity, sizeof(NodeId));
     }
-    return node;
+    if (count > 0) {
+        memcpy(ast->children + ast->child_count, statements, count * sizeof(NodeId));
+    }
+    NodeId block = ast_add_node(ast, TOKEN_LBRACE, ast->child_count, count, line);
+    ast->child_count += count;
+    return block;
+}
+
+int is_result_expression(TokenType kind) {
+    switch (kind) {
+        case TOKEN_PLUS: case TOKEN_MINUS: case TOKEN_MUL: case TOKEN_DIV:
+        case TOKEN_NUMBER: case TOKEN_STRING: case TOKEN_LPAREN:
+        case TOKEN_EQ: case TOKEN_NEQ: case TOKEN_LT: case TOKEN_GT:
+        case TOKEN_LTE: case TOKEN_GTE: case TOKEN_AND: case TOKEN_OR:
+        case TOKEN_NOT: case TOKEN_TRUE: case TOKEN_FALSE: case TOKEN_INPUT:
+        case NODE_ADD_NUMBERS: case NODE_CONCAT: case NODE_EQ_NUMBERS:
+        case NODE_NEQ_NUMBERS: case NODE_EQ_STRINGS: case NODE_NEQ_STRINGS:
+        case NODE_GUARDED_ADD_NUMBERS: case NODE_GUARDED_CONCAT: case NODE_GUARDED_EQ_NUMBERS:
+        case NODE_GUARDED_NEQ_NUMBERS: case NODE_GUARDED_EQ_STRINGS: case NODE_GUARDED_NEQ_STRINGS:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Utility function to print AST nodes
+void print_ast_node(Ast *ast, NodeId node, int depth) {
+    if (node == AST_NONE) return;
+    TokenType kind = ast_kind(ast, node);
+    double value = kind == TOKEN_NUMBER ? ast_number(ast, node) : kind == TOKEN_TRUE ? 1 : 0;
+    char *name = (kind == TOKEN_STRING || kind == TOKEN_IDENTIFIER || kind == TOKEN_ASSIGN) ? ast_name(ast, node) : NULL;
+    for (int i = 0; i < depth; i++) printf("  ");
+    printf("ASTNode: type=%d, value=%f, name=%s, line=%d\n", kind, value, name ? name : "NULL", ast->lines[node]);
+    if (kind == TOKEN_LBRACE) {
+        for (uint32_t i = 0; i < ast_statement_count(ast, node); i++) {
+            print_ast_node(ast, ast_statements(ast, node)[i], depth + 1);
+        }
+        return;
+    }
+    print_ast_node(ast, ast->left[node], depth + 1);
+    print_ast_node(ast, ast->right[node], depth + 1);
+}
+
+// Print the top-level statements, one tree each
+void print_ast(Ast *ast) {
+    for (uint32_t i = 0; i < ast_statement_count(ast, ast->root); i++) {
+        print_ast_node(ast, ast_statements(ast, ast->root)[i], 0);
+    }
+}
+
+// Report a syntax error and give up on the program: the lexer hands out
+// nothing but TOKEN_EOF from here on, so every rule unwinds, and parse()
+// returns NULL. Only the first error is reported.
+static NodeId syntax_error(Parser *parser, const char *format, ...) {
+    Lexer *lexer = parser->lexer;
+    if (!lexer->failed) {
+        char message[IO_REPORT_SIZE];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(message, sizeof(message), format, args);
+        va_end(args);
+        io_report(lexer->diagnostics, "Error: %s", message);
+        lexer->failed = 1;
+    }
+    lexer->current_token.type = TOKEN_EOF;
+    return AST_NONE;
 }
 
-// Parse a logical OR expression
-ASTNode* logical_or(Lexer *lexer) {
-    ASTNode *node = logical_and(lexer);
-    while (lexer->current_token.type == TOKEN_OR) {
+// How tightly each binary operator binds; -1 for tokens that are not one.
+// All of them associate to the left.
+static int binary_precedence(TokenType type) {
+    switch (type) {
+        case TOKEN_OR: return 0;
+        case TOKEN_AND: return 1;
+        case TOKEN_EQ: case TOKEN_NEQ: return 2;
+        case TOKEN_LT: case TOKEN_GT: case TOKEN_LTE: case TOKEN_GTE: return 3;
+        case TOKEN_PLUS: case TOKEN_MINUS: return 4;
+        case TOKEN_MUL: case TOKEN_DIV: return 5;
+        default: return -1;
+    }
+}
+
+static void push_operator(Parser *parser, Token token, NodeId left, int precedence) {
+    if (parser->operator_count == parser->operator_capacity) {
+        parser->operators = grow_array(parser->operators, &parser->operator_capacity, sizeof(PendingOperator));
+    }
+    parser->operators[parser->operator_count++] = (PendingOperator){token, left, precedence};
+}
+
+// Parse a number, string, boolean or identifier
+static NodeId parse_primary(Parser *parser) {
+    Lexer *lexer = parser->lexer;
+    Token token = lexer->current_token;
+    switch (token.type) {
+        case TOKEN_NUMBER:
+            lexer_advance(lexer);
+            return ast_add_number(parser->ast, token.value, token.line);
+        case TOKEN_STRING:
+        case TOKEN_IDENTIFIER:
+            lexer_advance(lexer);
+            return ast_add_named(parser->ast, token.type, token_name(lexer, token), AST_NONE, token.line);
+        case TOKEN_TRUE:
+        case TOKEN_FALSE:
+            lexer_advance(lexer);
+            return ast_add_node(parser->ast, token.type, AST_NONE, AST_NONE, token.line);
+        default:
+            return syntax_error(parser, "unknown factor: %d", token.type);
+    }
+}
+
+// Parse an expression. Operators whose right operand is still being read
+// wait on parser->operators instead of on the C stack, so deeply nested
+// parentheses and unary operators, and long chains, cost no native stack:
+// unary minus and not bind tightest, then * /, + -, the orderings, == !=,
+// and and or. A pending parenthesis or input( is closed by its ')'; an
+// input with nothing between its parentheses has an empty prompt.
+NodeId parse_expression(Parser *parser) {
+    Lexer *lexer = parser->lexer;
+    Ast *ast = parser->ast;
+    uint32_t base = parser->operator_count;
+    NodeId operand;
+    for (;;) {
+        // Prefixes wait for the operand after them
         Token token = lexer->current_token;
+        if (token.type == TOKEN_MINUS || token.type == TOKEN_NOT) {
+            push_operator(parser, token, AST_NONE, PRECEDENCE_UNARY);
+            lexer_advance(lexer);
+            continue;
+        } else if (token.type == TOKEN_LPAREN) {
+            push_operator(parser, token, AST_NONE, PRECEDENCE_GROUP);
+            lexer_advance(lexer);
+            continue;
+        } else if (token.type == TOKEN_INPUT) {
+            lexer_advance(lexer);
+            if (lexer->current_token.type != TOKEN_LPAREN) {
+                operand = syntax_error(parser, "expected '(' after input");
+                break;
+            }
+            lexer_advance(lexer);
+            push_operator(parser, token, AST_NONE, PRECEDENCE_GROUP);
+            if (lexer->current_token.type != TOKEN_RPAREN) {
+                continue;
+            }
+            operand = ast_add_named(ast, TOKEN_STRING, intern(&lexer->strings, "", 0), AST_NONE, token.line);
+        } else {
+            operand = parse_primary(parser);
+            if (lexer->failed) break;
+        }
+
+        // Then the operand completes every pending operator that binds at
+        // least as tightly as the token after it, and every group its ')'
+        // closes, until a binary operator needs a right operand
+        for (;;) {
+            int precedence = binary_precedence(lexer->current_token.type);
+            while (parser->operator_count > base) {
+                PendingOperator *top = &parser->operators[parser->operator_count - 1];
+                if (top->precedence == PRECEDENCE_GROUP || top->precedence < precedence) break;
+                operand = ast_add_node(ast, top->token.type, top->left, operand, top->token.line);
+                parser->operator_count--;
+            }
+            if (precedence >= 0 || lexer->current_token.type != TOKEN_RPAREN ||
+                parser->operator_count == base) {
+                break;
+            }
+            Token group = parser->operators[--parser->operator_count].token;
+            lexer_advance(lexer);
+            if (group.type == TOKEN_INPUT) {
+                operand = ast_add_node(ast, TOKEN_INPUT, operand, AST_NONE, group.line);
+            }
+        }
+        if (binary_precedence(lexer->current_token.type) < 0) {
+            if (parser->operator_count > base) {
+                operand = syntax_error(parser, "unmatched parenthesis"); // A group is still open
+            }
+            break;
+        }
+        push_operator(parser, lexer->current_token, operand, binary_precedence(lexer->current_token.type));
         lexer_advance(lexer);
-        ASTNode *new_node = init_ast_node(token.type, 0, NULL);
-        new_node->left = node;
-        new_node->right = logical_and(lexer);
-        node = new_node;
     }
-    return node;
+    parser->operator_count = base;
+    return operand;
 }
 
-// Parse an expression (logical OR)
-ASTNode* parse_expression(Lexer *lexer) {
-    return logical_or(lexer);
+// Queue a statement of the innermost open block
+static void push_pending(Parser *parser, NodeId statement) {
+    if (parser->pending_count == parser->pending_capacity) {
+        parser->pending = grow_array(parser->pending, &parser->pending_capacity, sizeof(NodeId));
+    }
+    parser->pending[parser->pending_count++] = statement;
+}
+
+// Turn the statements queued since `mark` into a block. Nested blocks are
+// closed before their parent continues, so each block's statements are the
+// top of the stack and the whole tree is built in linear time.
+static NodeId close_block(Parser *parser, uint32_t mark, int line) {
+    NodeId block = ast_add_block(parser->ast, parser->pending + mark, parser->pending_count - mark, line);
+    parser->pending_count = mark;
+    return block;
 }
 
 // Parse a block of statements
-ASTNode* parse_block(Lexer *lexer) {
-    ASTNode *block = init_ast_node(TOKEN_LBRACE, 0, NULL);
+NodeId parse_block(Parser *parser) {
+    Lexer *lexer = parser->lexer;
+    int line = lexer->current_token.line;
+    uint32_t mark = parser->pending_count;
     lexer_advance(lexer); // Advance past '{'
     while (lexer->current_token.type != TOKEN_RBRACE && lexer->current_token.type != TOKEN_EOF) {
-        ASTNode *stmt = parse_statement(lexer);
-        if (stmt) {
-            append_ast_node(block, stmt);
-        }
-        lexer_advance(lexer);
+        NodeId stmt = parse_statement(parser);
+        if (stmt == AST_NONE) break;
+        push_pending(parser, stmt);
     }
-    return block;
+    if (lexer->current_token.type != TOKEN_RBRACE) {
+        return syntax_error(parser, "expected '}'");
+    }
+    lexer_advance(lexer); // Advance past '}'
+    return close_block(parser, mark, line);
 }
 
-// Function to parse multiple statements
-ASTNode* parse_statements(Lexer *lexer) {
-    ASTNode *node = parse_statement(lexer);
-    ASTNode *root = node;
+// Function to parse multiple statements into the root block, which is
+// AST_NONE if not even the first statement parses
+NodeId parse_statements(Parser *parser) {
+    NodeId node = parse_statement(parser);
+    if (node == AST_NONE) return AST_NONE;
+    push_pending(parser, node);
 
-    while (lexer->current_token.type != TOKEN_EOF) {
-        ASTNode *next_node = parse_statement(lexer);
-        if (!next_node) break;
-        node->next = next_node;
-        node = next_node;
+    while (parser->lexer->current_token.type != TOKEN_EOF) {
+        NodeId next_node = parse_statement(parser);
+        if (next_node == AST_NONE) break;
+        push_pending(parser, next_node);
     }
 
-    return root;
+    return close_block(parser, 0, parser->ast->lines[node]);
 }
 
 // Parse a single statement
-ASTNode* parse_statement(Lexer *lexer) {
-    printf("Parsing statement: current token type = %d\n", lexer->current_token.type);
+NodeId parse_statement(Parser *parser) {
+    Lexer *lexer = parser->lexer;
+    TRACE(TRACE_PARSER, TRACE_DEBUG, "statement: current token type = %d", lexer->current_token.type);
     if (lexer->current_token.type == TOKEN_PRINT) {
-        return parse_print_statement(lexer);
+        return parse_print_statement(parser);
+    } else if (lexer->current_token.type == TOKEN_WHILE) {
+        return parse_while_statement(parser);
     } else if (lexer->current_token.type == TOKEN_IDENTIFIER) {
+        // Peek one token ahead, then rewind to just after the identifier
         Token token = lexer->current_token;
+        size_t saved_pos = lexer->pos;
+        int saved_line = lexer->line;
         lexer_advance(lexer);
-        if (lexer->current_token.type == TOKEN_ASSIGN) {
-            lexer->pos -= 2; // Go back to the beginning of the identifier
-            lexer->current_token = token; // Reset current token
-            return parse_assignment_statement(lexer);
-        } else {
-            lexer->pos -= 1; // Reset lexer position
-            lexer->current_token = token; // Reset current token
+        int is_assignment = lexer->current_token.type == TOKEN_ASSIGN;
+        lexer->pos = saved_pos;
+        lexer->line = saved_line;
+        lexer->current_token = token; // Reset current token
+        if (is_assignment) {
+            return parse_assignment_statement(parser);
         }
-    } 
-    
-    if (lexer->current_token.type == TOKEN_TRUE || lexer->current_token.type == TOKEN_FALSE || 
-        lexer->current_token.type == TOKEN_LPAREN || lexer->current_token.type == TOKEN_NUMBER || 
-        lexer->current_token.type == TOKEN_STRING || lexer->current_token.type == TOKEN_IDENTIFIER) {
+    }
+
+    if (lexer->current_token.type == TOKEN_TRUE || lexer->current_token.type == TOKEN_FALSE ||
+        lexer->current_token.type == TOKEN_LPAREN || lexer->current_token.type == TOKEN_NUMBER ||
+        lexer->current_token.type == TOKEN_STRING || lexer->current_token.type == TOKEN_IDENTIFIER ||
+        lexer->current_token.type == TOKEN_INPUT) {
         // Parse and return the expression as a statement
-        ASTNode *expr = parse_expression(lexer);
-        if (expr) {
+        NodeId expr = parse_expression(parser);
+        if (expr != AST_NONE) {
             lexer_advance(lexer); // Ensure lexer advances after parsing the expression
             return expr;
         }
     }
 
-    // If no valid statement is found, return NULL (or handle error)
-    printf("Error: unknown statement\n");
-    return NULL;
+    // Anything else cannot start a statement, at the top level as in a block
+    return syntax_error(parser, "unknown statement");
 }
 
 // Parse a print statement
-ASTNode* parse_print_statement(Lexer *lexer) {
-    printf("Parsing print statement\n");
-    lexer_advance(lexer); // Advance past 'print'
-    ASTNode *expr = parse_expression(lexer); // Parse the expression to print
-    return init_ast_node_with_children(TOKEN_PRINT, expr);
+NodeId parse_print_statement(Parser *parser) {
+    TRACE(TRACE_PARSER, TRACE_DEBUG, "print statement");
+    int line = parser->lexer->current_token.line;
+    lexer_advance(parser->lexer); // Advance past 'print'
+    NodeId expr = parse_expression(parser); // Parse the expression to print
+    return ast_add_node(parser->ast, TOKEN_PRINT, expr, AST_NONE, line);
 }
 
 // Parse an assignment statement
-ASTNode* parse_assignment_statement(Lexer *lexer) {
-    printf("Parsing assignment statement\n");
+NodeId parse_assignment_statement(Parser *parser) {
+    TRACE(TRACE_PARSER, TRACE_DEBUG, "assignment statement");
+    Lexer *lexer = parser->lexer;
     Token token = lexer->current_token;
     lexer_advance(lexer); // Advance past identifier
     if (lexer->current_token.type != TOKEN_ASSIGN) {
-        printf("Error: expected '='\n");
-        return NULL;
+        return syntax_error(parser, "expected '='");
     }
     lexer_advance(lexer); // Advance past '='
-    ASTNode *expr = parse_expression(lexer);
-    ASTNode *node = init_ast_node_with_children(TOKEN_ASSIGN, expr);
-    node->name = strdup(token.name); // Store the variable name
-    return node;
+    NodeId expr = parse_expression(parser);
+    // Store the (interned) variable name
+    return ast_add_named(parser->ast, TOKEN_ASSIGN, token_name(lexer, token), expr, token.line);
 }
 
 // Parse a while statement
-ASTNode* parse_while_statement(Lexer *lexer) {
-    printf("Parsing while statement\n");
+NodeId parse_while_statement(Parser *parser) {
+    TRACE(TRACE_PARSER, TRACE_DEBUG, "while statement");
+    Lexer *lexer = parser->lexer;
+    int line = lexer->current_token.line;
     lexer_advance(lexer); // Advance past 'while'
-    ASTNode *condition = parse_expression(lexer);
-    ASTNode *body = parse_block(lexer);
-    ASTNode *node = init_ast_node_with_children(TOKEN_WHILE, condition);
-    node->body = body;
-    return node;
-}
-
-// Initialize an AST node with children
-ASTNode* init_ast_node_with_children(TokenType type, ASTNode *child) {
-    ASTNode *node = init_ast_node(type, 0, NULL);
-    node->left = child;
-    return node;
-}
-
-// Initialize a basic AST node
-ASTNode* init_ast_node(TokenType type, double value, char *name) {
-    ASTNode *node = (ASTNode*)malloc(sizeof(ASTNode));
-    node->type = type;
-    node->value = value;
-    node->name = name ? strdup(name) : NULL;
-    node->left = NULL;
-    node->right = NULL;
-    node->condition = NULL;
-    node->body = NULL;
-    node->else_body = NULL;
-    node->next = NULL;
-    return node;
-}
-
-// Append an AST node as a child to a parent node (for block statements)
-void append_ast_node(ASTNode *parent, ASTNode *child) {
-    if (!parent->left) {
-        parent->left = child;
-    } else {
-        ASTNode *current = parent->left;
-        while (current->right) {
-            current = current->right;
-        }
-        current->right = child;
+    NodeId condition = parse_expression(parser);
+    if (lexer->current_token.type != TOKEN_LBRACE) {
+        return syntax_error(parser, "expected '{'");
     }
+    NodeId body = parse_block(parser);
+    return ast_add_node(parser->ast, TOKEN_WHILE, condition, body, line);
 }
 
-// Entry point for parsing
-ASTNode* parse(Lexer *lexer) {
+// Entry point for parsing. Returns NULL if there is no statement to run or
+// the source has a syntax error, which has been reported on stderr.
+Ast* parse(Lexer *lexer) {
+    Parser parser = {lexer, ast_create(), NULL, 0, 0, NULL, 0, 0};
+    parser.ast->diagnostics = lexer->diagnostics;
     lexer_advance(lexer);
-    printf("Starting parsing\n");
-    ASTNode *root = parse_statements(lexer);
-    printf("Finished parsing\n");
-    return root;
+    TRACE(TRACE_PARSER, TRACE_INFO, "starting parse of %zu bytes", lexer->length);
+    parser.ast->root = parse_statements(&parser);
+    TRACE(TRACE_PARSER, TRACE_INFO, "finished parsing");
+    free(parser.pending);
+    free(parser.operators);
+    if (parser.ast->root == AST_NONE || lexer->failed) {
+        free_ast(parser.ast);
+        return NULL;
+    }
+    return parser.ast;
 }
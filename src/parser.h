@@ -1,30 +1,139 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <stdint.h>
 #include "lexer.h"
 
-typedef struct ASTNode {
-    TokenType type;
-    double value;
-    char *name;
-    struct ASTNode *left;
-    struct ASTNode *right;
-    struct ASTNode *condition;
-    struct ASTNode *body;
-    struct ASTNode *else_body;
-    struct ASTNode *next;
-} ASTNode;
-
-ASTNode* init_ast_node(TokenType type, double value, char *name);
-ASTNode* init_ast_node_with_children(TokenType type, ASTNode *child);
-ASTNode* parse(Lexer *lexer);
-ASTNode* parse_block(Lexer *lexer);
-ASTNode* parse_statement(Lexer *lexer);
-ASTNode* parse_print_statement(Lexer *lexer);
-ASTNode* parse_expression(Lexer *lexer);
-ASTNode* parse_assignment_statement(Lexer *lexer);
-ASTNode* parse_while_statement(Lexer *lexer);
-void append_ast_node(ASTNode *parent, ASTNode *child);
-void print_ast_node(ASTNode *node, int depth);
+// Node flags
+#define AST_CHECK_DEFINED 1 // Identifier read that may precede every assignment
+#define AST_GENERIC       2 // Operator that met operands of mixed types; stays generic
+
+// Number of node kinds, for tables indexed by kind
+#define AST_KIND_COUNT (NODE_GUARDED_NEQ_STRINGS + 1)
+
+// Types the type pass (types.h) proves for expressions
+typedef enum {
+    NODE_TYPE_UNKNOWN, // Not inferred, or differs between executions
+    NODE_TYPE_NUMBER,
+    NODE_TYPE_STRING,
+    NODE_TYPE_BOOL
+} NodeType;
+
+// Index of a node in its Ast. Index 0 is reserved, so a zeroed child is "none".
+typedef uint32_t NodeId;
+#define AST_NONE 0
+
+// Syntax tree stored as a structure of arrays: node n is kinds[n], left[n],
+// right[n] and so on, and every column grows together. What the columns mean
+// depends on the kind:
+//
+//   TOKEN_NUMBER          data = index into numbers
+//   TOKEN_STRING          data = index into names
+//   TOKEN_IDENTIFIER      data = index into names, slots = variable slot
+//   binary operators      left, right = operands
+//   TOKEN_MINUS (unary)   left = AST_NONE, right = operand
+//   TOKEN_NOT             right = operand
+//   TOKEN_INPUT           left = prompt expression
+//   TOKEN_PRINT           left = expression, AST_NONE for a bare print
+//   TOKEN_ASSIGN          left = expression, data = index into names, slots = variable slot
+//   TOKEN_WHILE           left = condition, right = TOKEN_LBRACE body
+//   TOKEN_LBRACE          left = first entry in children, right = statement count
+//
+// Any other kind heading a statement is an expression statement.
+typedef struct {
+    uint8_t *kinds;   // TokenType
+    uint8_t *flags;
+    NodeId *left;
+    NodeId *right;
+    uint32_t *data;
+    int32_t *slots;   // -1 until resolved
+    int32_t *lines;   // Source line, 0 if unknown
+    uint8_t *types;   // NodeType of every node, NULL until infer_types() runs
+    uint32_t count;
+    uint32_t capacity;
+
+    double *numbers;
+    uint32_t number_count;
+    uint32_t number_capacity;
+
+    char **names;     // Interned by the lexer, so shared rather than copied
+    uint32_t name_count;
+    uint32_t name_capacity;
+
+    NodeId *children; // Statement lists of blocks, each one contiguous
+    uint32_t child_count;
+    uint32_t child_capacity;
+
+    NodeId root;      // TOKEN_LBRACE holding the top-level statements
+    Io *diagnostics;  // Where passes over the tree report problems, as the lexer did
+} Ast;
+
+// Operator of an expression that is waiting for its right operand: a binary
+// operator and its left operand, a unary operator, or an open parenthesis
+// or input( waiting for its ')'
+#define PRECEDENCE_UNARY 6
+#define PRECEDENCE_GROUP 7
+typedef struct {
+    Token token;
+    NodeId left;
+    int precedence;
+} PendingOperator;
+
+// Parser state: the lexer, the tree being built, a stack of statements
+// whose enclosing block is still open and a stack of pending operators
+typedef struct {
+    Lexer *lexer;
+    Ast *ast;
+    NodeId *pending;
+    uint32_t pending_count;
+    uint32_t pending_capacity;
+    PendingOperator *operators;
+    uint32_t operator_count;
+    uint32_t operator_capacity;
+} Parser;
+
+Ast* ast_create(void);
+void free_ast(Ast *ast);
+NodeId ast_add_node(Ast *ast, TokenType kind, NodeId left, NodeId right, int line);
+NodeId ast_add_number(Ast *ast, double value, int line);
+NodeId ast_add_named(Ast *ast, TokenType kind, char *name, NodeId left, int line);
+NodeId ast_add_block(Ast *ast, const NodeId *statements, uint32_t count, int line);
+void ast_set_number(Ast *ast, NodeId node, double value);
+void ast_set_name(Ast *ast, NodeId node, char *name);
+
+static inline TokenType ast_kind(const Ast *ast, NodeId node) {
+    return (TokenType)ast->kinds[node];
+}
+
+static inline double ast_number(const Ast *ast, NodeId node) {
+    return ast->numbers[ast->data[node]];
+}
+
+static inline char* ast_name(const Ast *ast, NodeId node) {
+    return ast->names[ast->data[node]];
+}
+
+// Statements of a TOKEN_LBRACE node. The pointer is invalidated by adding a block.
+static inline NodeId* ast_statements(const Ast *ast, NodeId block) {
+    return ast->children + ast->left[block];
+}
+
+static inline uint32_t ast_statement_count(const Ast *ast, NodeId block) {
+    return ast->right[block];
+}
+
+// Whether a statement of this kind is an expression whose value is echoed as
+// "Result: ...", as the tree walker's statement table says
+int is_result_expression(TokenType kind);
+
+Ast* parse(Lexer *lexer);
+NodeId parse_block(Parser *parser);
+NodeId parse_statement(Parser *parser);
+NodeId parse_print_statement(Parser *parser);
+NodeId parse_expression(Parser *parser);
+NodeId parse_assignment_statement(Parser *parser);
+NodeId parse_while_statement(Parser *parser);
+void print_ast(Ast *ast);
+void print_ast_node(Ast *ast, NodeId node, int depth);
 
 #endif // PARSER_H
@@ -0,0 +1,307 @@
+#include "profiler.h"
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Requested sampling rate; CPU-time timers are often coarser, so reported
+// times are scaled from the measured CPU time rather than this interval
+#define PROFILE_SAMPLE_INTERVAL_NS 100000
+
+int profiling_enabled = 0;
+
+// Entries are indexed by node, so the hot path needs no lookup. Nodes the
+// program never reaches keep zero counts and are skipped in the reports.
+typedef struct {
+    int parent;          // Enclosing node, -1 for top-level statements
+    uint64_t count;      // Exact number of visits
+    uint64_t inclusive;  // Samples taken while the node was on the stack
+    uint64_t exclusive;  // Samples taken while the node was on top
+} ProfileEntry;
+
+static Ast *profiled_ast = NULL;
+static ProfileEntry *entries = NULL;
+static int entry_count = 0;
+
+// Shadow stack of node ids, sized up front so the signal handler never
+// observes a reallocation
+static int *stack = NULL;
+static volatile sig_atomic_t depth = 0;
+static int max_depth = 0;
+
+static timer_t sample_timer;
+static int timer_armed = 0;
+static uint64_t total_samples = 0;
+static double start_cpu_ms = 0;
+static double elapsed_cpu_ms = 0;
+
+static double cpu_time_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return (double)now.tv_sec * 1e3 + (double)now.tv_nsec / 1e6;
+}
+
+// A node whose parent is recorded, waiting to have its children numbered
+typedef struct {
+    NodeId node;
+    int level; // Shadow stack depth while the node runs
+} PendingNode;
+
+static PendingNode *pending = NULL;
+static size_t pending_count = 0;
+static size_t pending_capacity = 0;
+
+static void push_pending(NodeId node, int parent, int level) {
+    if (node == AST_NONE) return;
+    entries[node].parent = parent;
+    if (pending_count == pending_capacity) {
+        pending_capacity = pending_capacity ? pending_capacity * 2 : 256;
+        pending = realloc(pending, pending_capacity * sizeof(PendingNode));
+        if (!pending) {
+            fprintf(stderr, "Out of memory while profiling\n");
+            exit(1);
+        }
+    }
+    pending[pending_count++] = (PendingNode){node, level};
+}
+
+// Record every node's parent and find the deepest nesting the shadow stack
+// has to hold. Nodes wait on a heap stack rather than the C stack, so the
+// walk takes constant native stack however deep the program nests.
+static void number_nodes(void) {
+    // The root block is not a frame of its own
+    for (uint32_t i = 0; i < ast_statement_count(profiled_ast, profiled_ast->root); i++) {
+        push_pending(ast_statements(profiled_ast, profiled_ast->root)[i], -1, 1);
+    }
+    while (pending_count > 0) {
+        PendingNode next = pending[--pending_count];
+        if (next.level > max_depth) max_depth = next.level;
+        if (ast_kind(profiled_ast, next.node) == TOKEN_LBRACE) {
+            for (uint32_t i = 0; i < ast_statement_count(profiled_ast, next.node); i++) {
+                push_pending(ast_statements(profiled_ast, next.node)[i], (int)next.node, next.level + 1);
+            }
+            continue;
+        }
+        push_pending(profiled_ast->left[next.node], (int)next.node, next.level + 1);
+        push_pending(profiled_ast->right[next.node], (int)next.node, next.level + 1);
+    }
+    free(pending);
+    pending = NULL;
+    pending_capacity = 0;
+}
+
+static void take_sample(int signo) {
+    (void)signo;
+    int top = depth;
+    if (top == 0) return;
+    entries[stack[top - 1]].exclusive++;
+    for (int i = 0; i < top; i++) {
+        entries[stack[i]].inclusive++;
+    }
+    total_samples++;
+}
+
+void profile_start(Ast *ast) {
+    profiled_ast = ast;
+    entry_count = (int)ast->count;
+    entries = calloc(entry_count, sizeof(ProfileEntry));
+    if (!entries) {
+        fprintf(stderr, "Out of memory while profiling\n");
+        exit(1);
+    }
+    number_nodes();
+    stack = malloc((max_depth + 1) * sizeof(int));
+    if (!stack) {
+        fprintf(stderr, "Out of memory while profiling\n");
+        exit(1);
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = take_sample;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &action, NULL);
+
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo = SIGPROF;
+    if (timer_create(CLOCK_PROCESS_CPUTIME_ID, &event, &sample_timer) == 0) {
+        struct itimerspec interval = {{0, PROFILE_SAMPLE_INTERVAL_NS}, {0, PROFILE_SAMPLE_INTERVAL_NS}};
+        timer_settime(sample_timer, 0, &interval, NULL);
+        timer_armed = 1;
+    } else {
+        perror("Failed to start profiling timer");
+    }
+    start_cpu_ms = cpu_time_ms();
+    profiling_enabled = 1;
+}
+
+void profile_stop(void) {
+    if (timer_armed) {
+        timer_delete(sample_timer);
+        timer_armed = 0;
+    }
+    signal(SIGPROF, SIG_IGN);
+    elapsed_cpu_ms = cpu_time_ms() - start_cpu_ms;
+    profiling_enabled = 0;
+}
+
+void profile_enter(NodeId node) {
+    entries[node].count++;
+    stack[depth] = (int)node;
+    depth = depth + 1; // Publish the frame only after it is written
+}
+
+void profile_exit(void) {
+    depth = depth - 1;
+}
+
+static double samples_to_ms(uint64_t samples) {
+    if (total_samples == 0) return 0;
+    return elapsed_cpu_ms * (double)samples / (double)total_samples;
+}
+
+static const char* node_label(NodeId node) {
+    switch (ast_kind(profiled_ast, node)) {
+        case TOKEN_PRINT: return "print";
+        case TOKEN_ASSIGN: return "assign";
+        case TOKEN_WHILE: return "while";
+        case TOKEN_LBRACE: return "block";
+        case TOKEN_NUMBER: return "number";
+        case TOKEN_STRING: return "string";
+        case TOKEN_IDENTIFIER: return "var";
+        case TOKEN_TRUE: case TOKEN_FALSE: return "bool";
+        case TOKEN_PLUS: case NODE_ADD_NUMBERS: case NODE_GUARDED_ADD_NUMBERS: return "add";
+        case NODE_CONCAT: case NODE_GUARDED_CONCAT: return "concat";
+        case TOKEN_MINUS: return profiled_ast->left[node] != AST_NONE ? "sub" : "neg";
+        case TOKEN_MUL: return "mul";
+        case TOKEN_DIV: return "div";
+        case TOKEN_EQ: case NODE_EQ_NUMBERS: case NODE_EQ_STRINGS:
+        case NODE_GUARDED_EQ_NUMBERS: case NODE_GUARDED_EQ_STRINGS: return "eq";
+        case TOKEN_NEQ: case NODE_NEQ_NUMBERS: case NODE_NEQ_STRINGS:
+        case NODE_GUARDED_NEQ_NUMBERS: case NODE_GUARDED_NEQ_STRINGS: return "neq";
+        case TOKEN_LT: return "lt";
+        case TOKEN_GT: return "gt";
+        case TOKEN_LTE: return "lte";
+        case TOKEN_GTE: return "gte";
+        case TOKEN_AND: return "and";
+        case TOKEN_OR: return "or";
+        case TOKEN_NOT: return "not";
+        case TOKEN_INPUT: return "input";
+        default: return "node";
+    }
+}
+
+static void write_frame(FILE *out, NodeId node) {
+    TokenType kind = ast_kind(profiled_ast, node);
+    fprintf(out, "%s", node_label(node));
+    if (kind == TOKEN_ASSIGN || kind == TOKEN_IDENTIFIER) {
+        fprintf(out, "(%s)", ast_name(profiled_ast, node));
+    }
+    fprintf(out, "@%d", profiled_ast->lines[node]);
+}
+
+// Write the frames from the outermost statement down to `id`; `chain` has
+// room for the deepest nesting
+static void write_stack(FILE *out, int id, int *chain) {
+    int length = 0;
+    for (; id >= 0; id = entries[id].parent) {
+        chain[length++] = id;
+    }
+    while (length-- > 0) {
+        write_frame(out, (NodeId)chain[length]);
+        if (length > 0) fputc(';', out);
+    }
+}
+
+// Write one "frame;frame;frame samples" line per node with self samples,
+// the collapsed format read by flamegraph.pl and compatible tools
+int profile_write_folded(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror("Failed to write profile");
+        return 0;
+    }
+    int *chain = malloc((max_depth + 1) * sizeof(int));
+    if (!chain) {
+        fclose(out);
+        fprintf(stderr, "Out of memory while profiling\n");
+        return 0;
+    }
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].exclusive == 0) continue;
+        write_stack(out, i, chain);
+        fprintf(out, " %llu\n", (unsigned long long)entries[i].exclusive);
+    }
+    free(chain);
+    fclose(out);
+    return 1;
+}
+
+typedef struct {
+    int line;
+    uint64_t statements; // Executions of statements starting on the line
+    uint64_t nodes;      // Executions of any node on the line
+    uint64_t inclusive;  // Largest inclusive time of a statement on the line
+    uint64_t exclusive;
+} LineStats;
+
+static int compare_lines(const void *a, const void *b) {
+    const LineStats *x = a, *y = b;
+    if (x->exclusive != y->exclusive) return x->exclusive < y->exclusive ? 1 : -1;
+    return x->line - y->line;
+}
+
+static int is_statement(NodeId node) {
+    TokenType kind = ast_kind(profiled_ast, node);
+    return kind == TOKEN_PRINT || kind == TOKEN_ASSIGN || kind == TOKEN_WHILE;
+}
+
+// Print the hottest source lines by self time
+void profile_print_top_lines(FILE *out, int limit) {
+    int max_line = 0;
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].count > 0 && profiled_ast->lines[i] > max_line) max_line = profiled_ast->lines[i];
+    }
+    LineStats *lines = calloc(max_line + 1, sizeof(LineStats));
+    if (!lines) return;
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].count == 0) continue;
+        LineStats *stats = &lines[profiled_ast->lines[i]];
+        stats->line = profiled_ast->lines[i];
+        stats->nodes += entries[i].count;
+        stats->exclusive += entries[i].exclusive;
+        if (is_statement((NodeId)i)) {
+            stats->statements += entries[i].count;
+            if (entries[i].inclusive > stats->inclusive) stats->inclusive = entries[i].inclusive;
+        }
+    }
+    qsort(lines, max_line + 1, sizeof(LineStats), compare_lines);
+
+    fprintf(out, "%llu samples over %.1f ms of CPU time\n",
+            (unsigned long long)total_samples, elapsed_cpu_ms);
+    fprintf(out, "%6s %12s %14s %10s %10s %7s\n",
+            "line", "statements", "node visits", "total ms", "self ms", "self %");
+    for (int i = 0; i < limit && i <= max_line && lines[i].nodes > 0; i++) {
+        fprintf(out, "%6d %12llu %14llu %10.1f %10.1f %6.1f%%\n", lines[i].line,
+                (unsigned long long)lines[i].statements, (unsigned long long)lines[i].nodes,
+                samples_to_ms(lines[i].inclusive), samples_to_ms(lines[i].exclusive),
+                total_samples ? 100.0 * (double)lines[i].exclusive / (double)total_samples : 0.0);
+    }
+    free(lines);
+}
+
+void profile_free(void) {
+    free(entries);
+    free(stack);
+    entries = NULL;
+    stack = NULL;
+    profiled_ast = NULL;
+    entry_count = 0;
+    depth = 0;
+    max_depth = 0;
+    total_samples = 0;
+    elapsed_cpu_ms = 0;
+}
@@ -0,0 +1,21 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+#include "parser.h"
+
+// Sampling profiler for the tree walker. When enabled, the tree walker pushes
+// each statement and expression node onto a shadow stack and counts the
+// visit; a CPU-time timer samples that stack to attribute inclusive and
+// exclusive time. When disabled the hooks cost a single flag test.
+extern int profiling_enabled;
+
+void profile_start(Ast *ast);
+void profile_stop(void);
+void profile_enter(NodeId node);
+void profile_exit(void);
+int profile_write_folded(const char *path);
+void profile_print_top_lines(FILE *out, int limit);
+void profile_free(void);
+
+#endif // PROFILER_H
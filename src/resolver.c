@@ -0,0 +1,193 @@
+#include "resolver.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Whether a slot has been stored to at the current point of the walk
+typedef enum {
+    SLOT_UNASSIGNED,
+    SLOT_MAYBE_ASSIGNED, // Only assigned inside a loop body that may not have run
+    SLOT_ASSIGNED
+} SlotState;
+
+typedef struct {
+    Ast *ast;
+    Resolution *resolution;
+    unsigned char *states;
+    int capacity;
+
+    // Slots first assigned inside the enclosing while bodies
+    int *loop_assigned;
+    int loop_assigned_count;
+    int loop_assigned_capacity;
+    int loop_depth;
+
+    // Operands of the expression being resolved that are still to visit
+    NodeId *operands;
+    int operand_count;
+    int operand_capacity;
+
+    int errors;
+} Resolver;
+
+static void *grow_array(void *array, int *capacity, size_t element_size) {
+    *capacity = *capacity ? *capacity * 2 : 64;
+    array = realloc(array, (size_t)*capacity * element_size);
+    if (!array) {
+        fprintf(stderr, "Out of memory while resolving\n");
+        exit(1);
+    }
+    return array;
+}
+
+// Bind a name to its slot, allocating the next dense index on first sight
+static int bind(Resolver *r, const char *name) {
+    Resolution *res = r->resolution;
+    int slot = symbol_table_find(&res->symbols, name);
+    if (slot >= 0) return slot;
+
+    if (res->slot_count == r->capacity) {
+        int capacity = r->capacity;
+        res->names = grow_array(res->names, &capacity, sizeof(char*));
+        r->states = realloc(r->states, capacity);
+        if (!r->states) {
+            fprintf(stderr, "Out of memory while resolving\n");
+            exit(1);
+        }
+        r->capacity = capacity;
+    }
+    slot = res->slot_count++;
+    res->names[slot] = (char*)name;
+    r->states[slot] = SLOT_UNASSIGNED;
+    symbol_table_insert(&res->symbols, name, slot);
+    return slot;
+}
+
+// Bind the identifiers of an expression from left to right. Right operands
+// wait on r->operands while the left one is resolved, so nesting depth
+// costs no native stack.
+static void resolve_expression(Resolver *r, NodeId node) {
+    Ast *ast = r->ast;
+    for (;;) {
+        if (node == AST_NONE) {
+            if (r->operand_count == 0) return;
+            node = r->operands[--r->operand_count];
+        }
+        if (ast_kind(ast, node) != TOKEN_IDENTIFIER) {
+            if (ast->right[node] != AST_NONE) {
+                if (r->operand_count == r->operand_capacity) {
+                    r->operands = grow_array(r->operands, &r->operand_capacity, sizeof(NodeId));
+                }
+                r->operands[r->operand_count++] = ast->right[node];
+            }
+            node = ast->left[node];
+            continue;
+        }
+        int slot = bind(r, ast_name(ast, node));
+        ast->slots[node] = slot;
+        if (r->states[slot] == SLOT_UNASSIGNED) {
+            io_report(ast->diagnostics, "Undefined variable: %s", ast_name(ast, node));
+            r->errors++;
+        } else if (r->states[slot] == SLOT_MAYBE_ASSIGNED) {
+            ast->flags[node] |= AST_CHECK_DEFINED;
+        }
+        node = AST_NONE;
+    }
+}
+
+static void resolve_statements(Resolver *r, NodeId block);
+
+static void resolve_statement(Resolver *r, NodeId node) {
+    Ast *ast = r->ast;
+    int slot;
+    switch (ast_kind(ast, node)) {
+        case TOKEN_ASSIGN:
+            resolve_expression(r, ast->left[node]);
+            slot = bind(r, ast_name(ast, node));
+            ast->slots[node] = slot;
+            if (r->states[slot] != SLOT_ASSIGNED) {
+                r->states[slot] = SLOT_ASSIGNED;
+                if (r->loop_depth > 0) {
+                    if (r->loop_assigned_count == r->loop_assigned_capacity) {
+                        r->loop_assigned = grow_array(r->loop_assigned, &r->loop_assigned_capacity, sizeof(int));
+                    }
+                    r->loop_assigned[r->loop_assigned_count++] = slot;
+                }
+            }
+            break;
+        case TOKEN_WHILE:
+            {
+                resolve_expression(r, ast->left[node]);
+                int mark = r->loop_assigned_count;
+                r->loop_depth++;
+                resolve_statements(r, ast->right[node]);
+                r->loop_depth--;
+                // The body may run zero times, so its first assignments are only maybes
+                for (int i = mark; i < r->loop_assigned_count; i++) {
+                    r->states[r->loop_assigned[i]] = SLOT_MAYBE_ASSIGNED;
+                }
+                if (r->loop_depth == 0) {
+                    r->loop_assigned_count = 0;
+                }
+            }
+            break;
+        case TOKEN_LBRACE:
+            resolve_statements(r, node);
+            break;
+        case TOKEN_PRINT:
+            resolve_expression(r, ast->left[node]);
+            break;
+        default:
+            resolve_expression(r, node);
+            break;
+    }
+}
+
+static void resolve_statements(Resolver *r, NodeId block) {
+    for (uint32_t i = 0; i < ast_statement_count(r->ast, block); i++) {
+        resolve_statement(r, ast_statements(r->ast, block)[i]);
+    }
+}
+
+// Bind every identifier in the program to a slot before execution. Reads of
+// variables that cannot have been assigned yet are reported here, and make
+// this return NULL; reads that might follow a skipped loop body are flagged
+// for a run-time check.
+Resolution* resolve(Ast *ast) {
+    return resolve_with_inputs(ast, NULL, 0);
+}
+
+Resolution* resolve_with_inputs(Ast *ast, char **inputs, int input_count) {
+    Resolution *resolution = calloc(1, sizeof(Resolution));
+    if (!resolution) {
+        fprintf(stderr, "Out of memory while resolving\n");
+        exit(1);
+    }
+    symbol_table_init(&resolution->symbols);
+
+    Resolver r = {0};
+    r.ast = ast;
+    r.resolution = resolution;
+    for (int i = 0; i < input_count; i++) {
+        int slot = bind(&r, inputs[i]);
+        r.states[slot] = SLOT_ASSIGNED;
+    }
+    resolution->input_count = resolution->slot_count; // Repeated names share a slot
+    resolve_statements(&r, ast->root);
+
+    free(r.states);
+    free(r.loop_assigned);
+    free(r.operands);
+    if (r.errors) {
+        free_resolution(resolution);
+        return NULL;
+    }
+    return resolution;
+}
+
+void free_resolution(Resolution *resolution) {
+    if (!resolution) return;
+    free(resolution->names);
+    symbol_table_free(&resolution->symbols);
+    free(resolution);
+}
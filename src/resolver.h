@@ -0,0 +1,23 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "parser.h"
+#include "symbol_table.h"
+
+// Result of binding every variable in a program to a dense slot index
+typedef struct {
+    char **names;    // Slot index -> interned variable name
+    int slot_count;
+    int input_count; // Slots below this are inputs, set before the program runs
+    SymbolTable symbols;
+} Resolution;
+
+Resolution* resolve(Ast *ast);
+
+// Resolve a program whose variables `inputs` (interned names) are given
+// values before it runs, so reading them needs no earlier assignment. They
+// take the first slots, in order.
+Resolution* resolve_with_inputs(Ast *ast, char **inputs, int input_count);
+void free_resolution(Resolution *resolution);
+
+#endif // RESOLVER_H
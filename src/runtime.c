@@ -0,0 +1,83 @@
+#include "runtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef CALC_NO_NAN_BOXING
+#error "Compiled programs pass values as NaN-boxed 64-bit words"
+#endif
+
+// Wrap a string literal; literals are immortal, so it owns no reference
+Value calc_string(const char *chars) {
+    return STRING_VAL(chars);
+}
+
+Value calc_box_number(double number) {
+    return NUMBER_VAL(number);
+}
+
+Value calc_box_bool(int boolean) {
+    return BOOL_VAL(boolean);
+}
+
+Value calc_retain(Value value) {
+    value_retain(value);
+    return value;
+}
+
+void calc_release(Value value) {
+    value_release(value);
+}
+
+// Numeric operand of arithmetic or an ordering, read like the VM reads it
+double calc_number(Value value) {
+    value_release(value);
+    return value_as_number(value);
+}
+
+// Condition of a while, and, or or not: only true is true
+int calc_truthy(Value value) {
+    value_release(value);
+    return value_as_bool(value);
+}
+
+// + on operands whose types are not known statically
+Value calc_add(Value left, Value right) {
+    if (IS_STRING(left) || IS_STRING(right)) {
+        Value result = concatenate_values(left, right);
+        value_release(left);
+        value_release(right);
+        return result;
+    }
+    return NUMBER_VAL(value_as_number(left) + value_as_number(right));
+}
+
+int calc_equal(Value left, Value right) {
+    int equal = values_equal(left, right);
+    value_release(left);
+    value_release(right);
+    return equal;
+}
+
+void calc_print_number(const char *label, double number) {
+    print_value(io_standard(), label, NUMBER_VAL(number));
+}
+
+void calc_print_bool(const char *label, int boolean) {
+    print_value(io_standard(), label, BOOL_VAL(boolean));
+}
+
+void calc_print_value(const char *label, Value value) {
+    print_value(io_standard(), label, value);
+    value_release(value);
+}
+
+Value calc_input(Value prompt) {
+    Value line = read_input(io_standard(), prompt);
+    value_release(prompt);
+    return line;
+}
+
+void calc_undefined(const char *name) {
+    fprintf(stderr, "Undefined variable: %s\n", name);
+    exit(1);
+}
@@ -0,0 +1,27 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include "value.h"
+
+// Runtime library linked into programs compiled with --emit-llvm (see
+// llvm.h). Compiled code keeps numbers and booleans unboxed and only calls in
+// here for strings, for variables whose type changes, and for printing.
+// Boxed values cross the boundary as 64-bit words, so the runtime needs the
+// NaN-boxed representation. Functions marked "consumes" take over the
+// reference their argument owns, as the VM's instructions do.
+Value calc_string(const char *chars);
+Value calc_box_number(double number);
+Value calc_box_bool(int boolean);
+Value calc_retain(Value value);
+void calc_release(Value value);
+double calc_number(Value value);                 // Consumes
+int calc_truthy(Value value);                    // Consumes
+Value calc_add(Value left, Value right);         // Consumes both
+int calc_equal(Value left, Value right);         // Consumes both
+void calc_print_number(const char *label, double number);
+void calc_print_bool(const char *label, int boolean);
+void calc_print_value(const char *label, Value value); // Consumes
+Value calc_input(Value prompt);                  // Consumes
+void calc_undefined(const char *name);           // Does not return
+
+#endif // RUNTIME_H
@@ -0,0 +1,85 @@
+#include "string_builder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STRING_BUFFER_MIN_CAPACITY 32
+
+static void *checked_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        fprintf(stderr, "Out of memory building string\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+static void reserve(StringBuffer *buffer, size_t needed) {
+    if (needed <= buffer->capacity) return;
+    size_t capacity = buffer->capacity ? buffer->capacity : STRING_BUFFER_MIN_CAPACITY;
+    while (capacity < needed) {
+        capacity *= 2; // Geometric growth keeps appends amortised O(1)
+    }
+    buffer->data = realloc(buffer->data, capacity);
+    if (!buffer->data) {
+        fprintf(stderr, "Out of memory building string\n");
+        exit(1);
+    }
+    buffer->capacity = capacity;
+}
+
+static StringBuilder* make_builder(StringBuffer *buffer, size_t length) {
+    StringBuilder *builder = checked_malloc(sizeof(StringBuilder));
+    builder->refcount = 1;
+    buffer->refcount++;
+    builder->buffer = buffer;
+    builder->length = length;
+    return builder;
+}
+
+// Start a new buffer holding left followed by right
+StringBuilder* string_builder_new(const char *left, size_t left_length,
+                                  const char *right, size_t right_length) {
+    StringBuffer *buffer = checked_malloc(sizeof(StringBuffer));
+    buffer->refcount = 0;
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+    reserve(buffer, STRING_BUFFER_MIN_CAPACITY); // Even an empty string needs data to point at
+    reserve(buffer, (left_length + right_length) * 2);
+    memcpy(buffer->data, left, left_length);
+    memcpy(buffer->data + left_length, right, right_length);
+    buffer->length = left_length + right_length;
+    return make_builder(buffer, buffer->length);
+}
+
+// Return a builder for `builder + chars`. When the builder is the newest
+// string on its buffer the bytes are appended in place; otherwise another
+// string has already extended the buffer and the prefix must be copied.
+StringBuilder* string_builder_append(StringBuilder *builder, const char *chars, size_t length) {
+    StringBuffer *buffer = builder->buffer;
+    if (builder->length != buffer->length) {
+        return string_builder_new(buffer->data, builder->length, chars, length);
+    }
+    // chars may point into this buffer (s + s), so re-derive it after growing
+    size_t offset = (chars >= buffer->data && chars < buffer->data + buffer->capacity)
+                    ? (size_t)(chars - buffer->data) : (size_t)-1;
+    reserve(buffer, buffer->length + length);
+    if (offset != (size_t)-1) {
+        chars = buffer->data + offset;
+    }
+    memmove(buffer->data + buffer->length, chars, length);
+    buffer->length += length;
+    return make_builder(buffer, buffer->length);
+}
+
+// Drop a builder whose last reference is gone, and its buffer with it if no
+// other builder still views the buffer
+void string_builder_free(StringBuilder *builder) {
+    StringBuffer *buffer = builder->buffer;
+    if (--buffer->refcount == 0) {
+        free(buffer->data);
+        free(buffer);
+    }
+    free(builder);
+}
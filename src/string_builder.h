@@ -0,0 +1,33 @@
+#ifndef STRING_BUILDER_H
+#define STRING_BUILDER_H
+
+#include <stddef.h>
+
+// Growable, append-only character buffer shared by every string built on it
+typedef struct {
+    int refcount;    // Number of builders viewing this buffer
+    char *data;
+    size_t length;   // Bytes written so far
+    size_t capacity;
+} StringBuffer;
+
+// A string value: the first `length` bytes of a shared buffer. Appending to
+// the builder that ends at the buffer's tip extends the buffer in place, so a
+// loop doing `s = s + x` copies each byte once instead of once per iteration.
+typedef struct {
+    int refcount;    // Number of Values holding this builder
+    StringBuffer *buffer;
+    size_t length;
+} StringBuilder;
+
+StringBuilder* string_builder_new(const char *left, size_t left_length,
+                                  const char *right, size_t right_length);
+StringBuilder* string_builder_append(StringBuilder *builder, const char *chars, size_t length);
+void string_builder_free(StringBuilder *builder);
+
+// Reference counting: new builders start with a count of one
+#define string_builder_retain(b) ((b)->refcount++)
+#define string_builder_release(b) \
+    do { if (--(b)->refcount == 0) string_builder_free(b); } while (0)
+
+#endif // STRING_BUILDER_H
@@ -0,0 +1,79 @@
+#include "symbol_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SYMBOL_TABLE_INITIAL_CAPACITY 64
+
+// Hash an interned name by its address
+static uint32_t hash_name(const char *name) {
+    uint64_t bits = (uint64_t)(uintptr_t)name;
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33;
+    return (uint32_t)bits;
+}
+
+void symbol_table_init(SymbolTable *table) {
+    table->entries = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+void symbol_table_free(SymbolTable *table) {
+    free(table->entries);
+    symbol_table_init(table);
+}
+
+// Find the entry for a name, or the empty entry where it would be inserted
+static SymbolEntry* find_entry(SymbolEntry *entries, size_t capacity, const char *name) {
+    size_t mask = capacity - 1;
+    size_t index = hash_name(name) & mask;
+    for (;;) {
+        SymbolEntry *entry = &entries[index];
+        if (!entry->name || entry->name == name) {
+            return entry;
+        }
+        index = (index + 1) & mask; // Linear probing
+    }
+}
+
+static void grow(SymbolTable *table) {
+    size_t capacity = table->capacity ? table->capacity * 2 : SYMBOL_TABLE_INITIAL_CAPACITY;
+    SymbolEntry *entries = calloc(capacity, sizeof(SymbolEntry));
+    if (!entries) {
+        fprintf(stderr, "Out of memory growing symbol table\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < table->capacity; i++) {
+        SymbolEntry *old = &table->entries[i];
+        if (old->name) {
+            *find_entry(entries, capacity, old->name) = *old;
+        }
+    }
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+}
+
+// Return the slot bound to a name, or -1 if the name is unknown
+int symbol_table_find(SymbolTable *table, const char *name) {
+    if (table->count == 0) return -1;
+    SymbolEntry *entry = find_entry(table->entries, table->capacity, name);
+    return entry->name ? entry->slot : -1;
+}
+
+// Bind a name to a slot unless it is already bound; returns the bound slot
+int symbol_table_insert(SymbolTable *table, const char *name, int slot) {
+    // Keep the load factor at or below 3/4
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        grow(table);
+    }
+    SymbolEntry *entry = find_entry(table->entries, table->capacity, name);
+    if (entry->name) {
+        return entry->slot;
+    }
+    entry->name = name;
+    entry->slot = slot;
+    table->count++;
+    return slot;
+}
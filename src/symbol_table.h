@@ -0,0 +1,26 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Open-addressing hash table mapping variable names to dense slot indices.
+// Names are interned (see intern.h), so keys are hashed and compared by
+// pointer and the table never copies or frees them.
+typedef struct {
+    const char *name; // Interned name, NULL for an empty entry
+    int slot;
+} SymbolEntry;
+
+typedef struct {
+    SymbolEntry *entries;
+    size_t capacity; // Always a power of two
+    size_t count;
+} SymbolTable;
+
+void symbol_table_init(SymbolTable *table);
+void symbol_table_free(SymbolTable *table);
+int symbol_table_find(SymbolTable *table, const char *name);
+int symbol_table_insert(SymbolTable *table, const char *name, int slot);
+
+#endif // SYMBOL_TABLE_H
@@ -0,0 +1,68 @@
+#include "trace.h"
+
+#ifdef CALC_TRACE
+
+#include <stdarg.h>
+#include <string.h>
+
+#define TRACE_RING_ENTRIES 4096
+#define TRACE_ENTRY_SIZE 120
+
+TraceLevel trace_levels[TRACE_CATEGORY_COUNT];
+
+static const char *category_names[TRACE_CATEGORY_COUNT] = {"lexer", "parser", "eval"};
+static const char *level_names[] = {"off", "info", "debug"};
+
+// Fixed-size records; once full, the oldest records are overwritten
+static char ring[TRACE_RING_ENTRIES][TRACE_ENTRY_SIZE];
+static size_t ring_next = 0;  // Total records ever written
+
+void trace_log(TraceCategory category, TraceLevel level, const char *format, ...) {
+    char *entry = ring[ring_next % TRACE_RING_ENTRIES];
+    int prefix = snprintf(entry, TRACE_ENTRY_SIZE, "[%s:%s] ", category_names[category], level_names[level]);
+    va_list args;
+    va_start(args, format);
+    vsnprintf(entry + prefix, TRACE_ENTRY_SIZE - prefix, format, args);
+    va_end(args);
+    ring_next++;
+}
+
+// Enable categories from a spec such as "eval", "parser:info" or "all".
+// Entries are comma separated; the level defaults to debug.
+int trace_configure(const char *spec) {
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", spec);
+    for (char *item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+        TraceLevel level = TRACE_DEBUG;
+        char *colon = strchr(item, ':');
+        if (colon) {
+            *colon = '\0';
+            if (strcmp(colon + 1, "info") == 0) level = TRACE_INFO;
+            else if (strcmp(colon + 1, "debug") == 0) level = TRACE_DEBUG;
+            else if (strcmp(colon + 1, "off") == 0) level = TRACE_OFF;
+            else return 0;
+        }
+        int matched = 0;
+        for (int i = 0; i < TRACE_CATEGORY_COUNT; i++) {
+            if (strcmp(item, "all") == 0 || strcmp(item, category_names[i]) == 0) {
+                trace_levels[i] = level;
+                matched = 1;
+            }
+        }
+        if (!matched) return 0;
+    }
+    return 1;
+}
+
+// Print the retained records, oldest first
+void trace_dump(FILE *out) {
+    size_t first = ring_next > TRACE_RING_ENTRIES ? ring_next - TRACE_RING_ENTRIES : 0;
+    if (first > 0) {
+        fprintf(out, "[trace] %zu older records dropped\n", first);
+    }
+    for (size_t i = first; i < ring_next; i++) {
+        fprintf(out, "%s\n", ring[i % TRACE_RING_ENTRIES]);
+    }
+}
+
+#endif // CALC_TRACE
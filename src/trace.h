@@ -0,0 +1,42 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+// Debug tracing. Build with -DCALC_TRACE (make DEBUG=1) to enable; otherwise
+// every TRACE() expands to nothing, arguments included. Enabled traces are
+// written to an in-memory ring buffer and only printed by trace_dump().
+typedef enum {
+    TRACE_LEXER,
+    TRACE_PARSER,
+    TRACE_EVAL,
+    TRACE_CATEGORY_COUNT
+} TraceCategory;
+
+typedef enum {
+    TRACE_OFF,
+    TRACE_INFO,
+    TRACE_DEBUG
+} TraceLevel;
+
+#ifdef CALC_TRACE
+
+extern TraceLevel trace_levels[TRACE_CATEGORY_COUNT];
+
+#define TRACE(category, level, ...) \
+    do { \
+        if (trace_levels[category] >= (level)) trace_log((category), (level), __VA_ARGS__); \
+    } while (0)
+
+void trace_log(TraceCategory category, TraceLevel level, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+int trace_configure(const char *spec);
+void trace_dump(FILE *out);
+
+#else
+
+#define TRACE(category, level, ...) ((void)0)
+
+#endif // CALC_TRACE
+
+#endif // TRACE_H
@@ -0,0 +1,312 @@
+#include "types.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Types form a lattice: a variable not yet assigned is TYPE_NONE, one whose
+// type depends on the path taken is TYPE_ANY. Joining two different types
+// gives TYPE_ANY, and TYPE_NONE joins as the identity.
+typedef enum {
+    TYPE_NONE,
+    TYPE_NUMBER,
+    TYPE_STRING,
+    TYPE_BOOL,
+    TYPE_ANY
+} Type;
+
+// An operator waiting for the types of its operands: index counts the
+// operands typed so far, and left holds the first one's type
+typedef struct {
+    NodeId node;
+    uint8_t index;
+    uint8_t left;
+} TypeFrame;
+
+typedef struct {
+    Ast *ast;
+    Resolution *resolution;
+    int slot_count;
+    uint8_t *state;     // Type of every slot at the current point of the walk
+
+    // Types at the head of each while loop, slot_count per loop, kept across
+    // passes so that a pass only widens them
+    uint8_t *headers;
+    uint32_t header_count;
+    uint32_t header_capacity;
+    uint32_t *loop_headers; // Node -> 1 + index into headers, 0 before its first visit
+
+    int changed;        // A loop head widened during this pass
+    int final;          // Every head is settled: tag, report and specialise
+    int specialise;
+    uint8_t *declared;  // First type assigned to each slot, for warnings
+    int warnings;
+
+    // Operators of the expression being typed that wait for their operands
+    TypeFrame *frames;
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+} Inferrer;
+
+static void *checked_alloc(void *memory) {
+    if (!memory) {
+        fprintf(stderr, "Out of memory while inferring types\n");
+        exit(1);
+    }
+    return memory;
+}
+
+static Type join(Type a, Type b) {
+    if (a == b || b == TYPE_NONE) return a;
+    if (a == TYPE_NONE) return b;
+    return TYPE_ANY;
+}
+
+static NodeType node_type(Type type) {
+    switch (type) {
+        case TYPE_NUMBER: return NODE_TYPE_NUMBER;
+        case TYPE_STRING: return NODE_TYPE_STRING;
+        case TYPE_BOOL: return NODE_TYPE_BOOL;
+        default: return NODE_TYPE_UNKNOWN;
+    }
+}
+
+static const char* type_name(Type type) {
+    switch (type) {
+        case TYPE_NUMBER: return "number";
+        case TYPE_STRING: return "string";
+        default: return "bool";
+    }
+}
+
+// Kind to run an operator as once its operand types are known
+static TokenType specialised_kind(TokenType kind, Type left, Type right) {
+    switch (kind) {
+        case TOKEN_PLUS:
+            if (left == TYPE_NUMBER && right == TYPE_NUMBER) return NODE_ADD_NUMBERS;
+            if (left == TYPE_STRING || right == TYPE_STRING) return NODE_CONCAT;
+            return kind;
+        case TOKEN_EQ:
+        case TOKEN_NEQ:
+            if (left == TYPE_NUMBER && right == TYPE_NUMBER) {
+                return kind == TOKEN_EQ ? NODE_EQ_NUMBERS : NODE_NEQ_NUMBERS;
+            }
+            if (left == TYPE_STRING && right == TYPE_STRING) {
+                return kind == TOKEN_EQ ? NODE_EQ_STRINGS : NODE_NEQ_STRINGS;
+            }
+            return kind;
+        default:
+            return kind;
+    }
+}
+
+static int has_operands(Ast *ast, NodeId node) {
+    TokenType kind = ast_kind(ast, node);
+    return kind != TOKEN_IDENTIFIER && kind != TOKEN_NUMBER && kind != TOKEN_STRING;
+}
+
+// Type of a node given the types of its operands
+static Type infer_node(Inferrer *t, NodeId node, Type left, Type right) {
+    Ast *ast = t->ast;
+    TokenType kind = ast_kind(ast, node);
+    Type type;
+    switch (kind) {
+        case TOKEN_NUMBER:
+        case TOKEN_MINUS:
+        case TOKEN_MUL:
+        case TOKEN_DIV:
+            type = TYPE_NUMBER; // Arithmetic on anything else still gives a number
+            break;
+        case TOKEN_STRING:
+        case TOKEN_INPUT:
+            type = TYPE_STRING;
+            break;
+        case TOKEN_TRUE: case TOKEN_FALSE:
+        case TOKEN_EQ: case TOKEN_NEQ: case TOKEN_LT: case TOKEN_GT: case TOKEN_LTE: case TOKEN_GTE:
+        case TOKEN_AND: case TOKEN_OR: case TOKEN_NOT:
+            type = TYPE_BOOL;
+            break;
+        case TOKEN_IDENTIFIER:
+            // A slot still unassigned here is checked when it is read, so
+            // nothing is proven about it
+            type = (Type)t->state[ast->slots[node]];
+            if (type == TYPE_NONE) type = TYPE_ANY;
+            break;
+        case TOKEN_PLUS:
+            // string + anything = string, otherwise arithmetic
+            if (left == TYPE_STRING || right == TYPE_STRING) {
+                type = TYPE_STRING;
+            } else if (left == TYPE_ANY || right == TYPE_ANY) {
+                type = TYPE_ANY;
+            } else {
+                type = TYPE_NUMBER;
+            }
+            break;
+        default:
+            type = TYPE_ANY;
+            break;
+    }
+    if (t->final) {
+        ast->types[node] = (uint8_t)node_type(type);
+        if (t->specialise) {
+            ast->kinds[node] = (uint8_t)specialised_kind(kind, left, right);
+        }
+    }
+    return type;
+}
+
+// Type an expression bottom up. Operators wait in frames on the heap while
+// their operands are typed, so nesting depth costs no native stack.
+static Type infer_expression(Inferrer *t, NodeId node) {
+    Ast *ast = t->ast;
+    uint32_t base = t->frame_count;
+    Type type;
+    for (;;) {
+        // Go down the left operands, leaving a frame for each operator
+        while (node != AST_NONE && has_operands(ast, node)) {
+            if (t->frame_count == t->frame_capacity) {
+                t->frame_capacity = t->frame_capacity ? t->frame_capacity * 2 : 64;
+                t->frames = checked_alloc(realloc(t->frames, t->frame_capacity * sizeof(TypeFrame)));
+            }
+            t->frames[t->frame_count++] = (TypeFrame){node, 0, TYPE_NONE};
+            node = ast->left[node];
+        }
+        // A missing operand reads as 0
+        type = node == AST_NONE ? TYPE_NUMBER : infer_node(t, node, TYPE_NONE, TYPE_NONE);
+        // Hand the type to its operator, typing every operator that is
+        // complete, until one still has a right operand to type
+        for (;;) {
+            if (t->frame_count == base) return type;
+            TypeFrame frame = t->frames[t->frame_count - 1];
+            if (frame.index == 0) {
+                t->frames[t->frame_count - 1].index = 1;
+                t->frames[t->frame_count - 1].left = (uint8_t)type;
+                node = ast->right[frame.node];
+                break;
+            }
+            t->frame_count--;
+            type = infer_node(t, frame.node, (Type)frame.left, type);
+        }
+    }
+}
+
+static void infer_assignment(Inferrer *t, NodeId node) {
+    Ast *ast = t->ast;
+    int slot = ast->slots[node];
+    Type type = infer_expression(t, ast->left[node]);
+    if (t->final && type != TYPE_ANY) {
+        Type declared = (Type)t->declared[slot];
+        if (declared == TYPE_NONE) {
+            t->declared[slot] = (uint8_t)type;
+        } else if (declared != type) {
+            io_report(ast->diagnostics, "Type warning on line %d: %s holds a %s but is assigned a %s",
+                      ast->lines[node], t->resolution->names[slot], type_name(declared), type_name(type));
+            t->warnings++;
+        }
+    }
+    t->state[slot] = (uint8_t)type;
+}
+
+// Types at the head of a loop, created as unassigned on its first visit
+static uint8_t* loop_header(Inferrer *t, NodeId loop) {
+    size_t size = (size_t)t->slot_count;
+    if (t->loop_headers[loop] == 0) {
+        if (t->header_count == t->header_capacity) {
+            t->header_capacity = t->header_capacity ? t->header_capacity * 2 : 16;
+            t->headers = checked_alloc(realloc(t->headers, t->header_capacity * size + 1));
+        }
+        memset(t->headers + t->header_count * size, TYPE_NONE, size);
+        t->loop_headers[loop] = ++t->header_count;
+    }
+    return t->headers + (t->loop_headers[loop] - 1) * size;
+}
+
+static void infer_statements(Inferrer *t, NodeId block);
+
+// The head of a loop is reached from before the loop and from the end of its
+// body. Each pass joins both into the types kept for the head and walks the
+// body once from them; the caller repeats passes until no head widens.
+static void infer_while(Inferrer *t, NodeId node) {
+    Ast *ast = t->ast;
+    int changed = 0;
+    uint8_t *header = loop_header(t, node);
+    for (int slot = 0; slot < t->slot_count; slot++) {
+        Type type = join((Type)header[slot], (Type)t->state[slot]);
+        changed |= type != header[slot];
+        header[slot] = (uint8_t)type;
+    }
+    memcpy(t->state, header, (size_t)t->slot_count);
+    infer_expression(t, ast->left[node]);
+    infer_statements(t, ast->right[node]);
+    header = loop_header(t, node); // Loops in the body may have moved the table
+    for (int slot = 0; slot < t->slot_count; slot++) {
+        Type type = join((Type)header[slot], (Type)t->state[slot]);
+        changed |= type != header[slot];
+        header[slot] = (uint8_t)type;
+    }
+    t->changed |= changed;
+    memcpy(t->state, header, (size_t)t->slot_count); // The loop exits from its head
+}
+
+static void infer_statements(Inferrer *t, NodeId block) {
+    Ast *ast = t->ast;
+    uint32_t count = ast_statement_count(ast, block);
+    for (uint32_t i = 0; i < count; i++) {
+        NodeId node = ast_statements(ast, block)[i];
+        switch (ast_kind(ast, node)) {
+            case TOKEN_ASSIGN:
+                infer_assignment(t, node);
+                break;
+            case TOKEN_WHILE:
+                infer_while(t, node);
+                break;
+            case TOKEN_LBRACE:
+                infer_statements(t, node);
+                break;
+            case TOKEN_PRINT:
+                infer_expression(t, ast->left[node]);
+                break;
+            default:
+                infer_expression(t, node); // Expression statement
+                break;
+        }
+    }
+}
+
+// Types before the first statement: variables are unassigned, except inputs,
+// which hold whatever the caller set
+static void start_state(Inferrer *t) {
+    memset(t->state, TYPE_NONE, (size_t)t->slot_count);
+    memset(t->state, TYPE_ANY, (size_t)t->resolution->input_count);
+}
+
+int infer_types(Ast *ast, Resolution *resolution, int specialise) {
+    Inferrer t = {0};
+    t.ast = ast;
+    t.resolution = resolution;
+    t.slot_count = resolution->slot_count;
+    t.specialise = specialise;
+    t.state = checked_alloc(calloc((size_t)t.slot_count + 1, 1));
+    t.declared = checked_alloc(calloc((size_t)t.slot_count + 1, 1));
+    t.loop_headers = checked_alloc(calloc(ast->count, sizeof(uint32_t)));
+    free(ast->types);
+    ast->types = checked_alloc(calloc(ast->count, 1));
+
+    // Heads only widen and each slot can widen twice, so this terminates;
+    // nested loops usually settle in a pass per level. The last pass, run
+    // once nothing changes, records the results.
+    do {
+        t.changed = 0;
+        start_state(&t);
+        infer_statements(&t, ast->root);
+    } while (t.changed);
+    t.final = 1;
+    start_state(&t);
+    infer_statements(&t, ast->root);
+
+    free(t.state);
+    free(t.declared);
+    free(t.headers);
+    free(t.loop_headers);
+    free(t.frames);
+    return t.warnings;
+}
@@ -0,0 +1,19 @@
+#ifndef TYPES_H
+#define TYPES_H
+
+#include "parser.h"
+#include "resolver.h"
+
+// Static type pass. Walks a resolved program in execution order, tracking the
+// type each variable holds at every point, from unassigned at the start (or
+// any type, for the inputs of resolve_with_inputs()) (a while loop is walked until the
+// types at its head stop changing), and records in ast->types the type every
+// expression is proven to have. An assignment that gives a variable a
+// different type from the one it was first assigned, such as a number
+// becoming a string, is reported as a warning to ast->diagnostics; the
+// program still runs. With `specialise` set, + == and != whose operand types are proven
+// become the NODE_* kinds, which the executors run without checking tags.
+// Returns the number of warnings.
+int infer_types(Ast *ast, Resolution *resolution, int specialise);
+
+#endif // TYPES_H
@@ -0,0 +1,96 @@
+#include "value.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Print a value as "<label>: <value>"
+void print_value(Io *io, const char *label, Value value) {
+    char scratch[NUMBER_BUFFER_SIZE];
+    size_t length;
+    const char *chars = value_chars(value, &length, scratch);
+    io_write(io, label, strlen(label));
+    io_write(io, ": ", 2);
+    io_write(io, chars, length);
+    io_newline(io);
+}
+
+// input(prompt): show the prompt, then read a line as a string. Borrows the
+// prompt and returns an owned value; at end of input every read is "".
+Value read_input(Io *io, Value prompt) {
+    char scratch[NUMBER_BUFFER_SIZE];
+    size_t length;
+    const char *chars = value_chars(prompt, &length, scratch);
+    io_write(io, chars, length);
+    if (!io_read_line(io, &chars, &length) || length == 0) {
+        return STRING_VAL("");
+    }
+    return BUILDER_VAL(string_builder_new(chars, length, "", 0));
+}
+
+// View the characters of a value without copying strings. Numbers are
+// formatted into the caller's scratch buffer. The result is not necessarily
+// NUL-terminated; use the returned length.
+const char* value_chars(Value value, size_t *length, char *scratch) {
+    switch (value_type(value)) {
+        case VAL_STRING:
+            *length = strlen(AS_CSTRING(value));
+            return AS_CSTRING(value);
+        case VAL_BUILDER:
+            *length = AS_BUILDER(value)->length;
+            return AS_BUILDER(value)->buffer->data;
+        case VAL_BOOL:
+            *length = AS_BOOL(value) ? 4 : 5;
+            return AS_BOOL(value) ? "True" : "False";
+        case VAL_NUMBER:
+            *length = format_number(AS_NUMBER(value), scratch);
+            return scratch;
+        default:
+            *length = 0;
+            return "";
+    }
+}
+
+// Function to convert a value to a string (flattens builders into a new copy)
+char* value_to_string(Value value) {
+    char scratch[NUMBER_BUFFER_SIZE];
+    size_t length;
+    const char *chars = value_chars(value, &length, scratch);
+    char *copy = malloc(length + 1);
+    memcpy(copy, chars, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// Concatenate two values as strings (string + anything = string). A builder on
+// the left is extended in place when possible.
+Value concatenate_values(Value left, Value right) {
+    char left_scratch[NUMBER_BUFFER_SIZE], right_scratch[NUMBER_BUFFER_SIZE];
+    size_t right_length;
+    const char *right_chars = value_chars(right, &right_length, right_scratch);
+    if (IS_BUILDER(left)) {
+        return BUILDER_VAL(string_builder_append(AS_BUILDER(left), right_chars, right_length));
+    }
+    size_t left_length;
+    const char *left_chars = value_chars(left, &left_length, left_scratch);
+    return BUILDER_VAL(string_builder_new(left_chars, left_length, right_chars, right_length));
+}
+
+// Compare the text of two values. Numbers and booleans are formatted, so
+// this is also the comparison of a string with anything else.
+int strings_equal(Value left, Value right) {
+    char left_scratch[NUMBER_BUFFER_SIZE], right_scratch[NUMBER_BUFFER_SIZE];
+    size_t left_length, right_length;
+    const char *left_chars = value_chars(left, &left_length, left_scratch);
+    const char *right_chars = value_chars(right, &right_length, right_scratch);
+    return left_length == right_length && memcmp(left_chars, right_chars, left_length) == 0;
+}
+
+// Compare two values for equality, comparing as strings if either side is one
+int values_equal(Value left, Value right) {
+    if (IS_STRING(left) || IS_STRING(right)) {
+        return strings_equal(left, right);
+    }
+    if (IS_BOOL(left) && IS_BOOL(right)) {
+        return AS_BOOL(left) == AS_BOOL(right);
+    }
+    return value_as_number(left) == value_as_number(right);
+}
@@ -0,0 +1,147 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "string_builder.h"
+#include "number.h"
+#include "io.h"
+
+typedef enum {
+    VAL_NUMBER,
+    VAL_STRING,
+    VAL_BOOL,
+    VAL_BUILDER,  // String produced by concatenation, viewed through a StringBuilder
+    VAL_UNDEFINED // Contents of a variable slot before its first assignment
+} ValueType;
+
+// Values are accessed only through the macros below, so the representation
+// can be chosen at build time. By default a Value is NaN-boxed into 64 bits:
+// numbers are stored as their own bits, and every other type lives in the
+// payload of a quiet NaN that arithmetic never produces. Build with
+// -DCALC_NO_NAN_BOXING for the plain tagged union.
+#ifndef CALC_NO_NAN_BOXING
+
+typedef uint64_t Value;
+
+#define QNAN        ((uint64_t)0x7ffc000000000000)
+#define TAG_STRING  ((uint64_t)0x0001000000000000) // Payload is a char *
+#define TAG_BUILDER ((uint64_t)0x0002000000000000) // Payload is a StringBuilder *
+#define TAG_MASK    (QNAN | TAG_STRING | TAG_BUILDER | ((uint64_t)1 << 63))
+#define PAYLOAD_MASK ((uint64_t)0x0000ffffffffffff)
+
+#define UNDEFINED_VAL (QNAN | 1)
+#define FALSE_VAL     (QNAN | 2)
+#define TRUE_VAL      (QNAN | 3)
+
+#define IS_NUMBER(v)    (((v) & QNAN) != QNAN)
+#define IS_BOOL(v)      (((v) | 1) == TRUE_VAL)
+#define IS_UNDEFINED(v) ((v) == UNDEFINED_VAL)
+#define IS_BUILDER(v)   (((v) & TAG_MASK) == (QNAN | TAG_BUILDER))
+#define IS_STRING(v)    (((v) & (QNAN | ((uint64_t)1 << 63))) == QNAN && ((v) & (TAG_STRING | TAG_BUILDER)) != 0)
+
+#define AS_NUMBER(v)  value_to_double(v)
+#define AS_BOOL(v)    ((v) == TRUE_VAL)
+#define AS_CSTRING(v) ((char *)(uintptr_t)((v) & PAYLOAD_MASK))
+#define AS_BUILDER(v) ((StringBuilder *)(uintptr_t)((v) & PAYLOAD_MASK))
+
+#define NUMBER_VAL(n)  double_to_value(n)
+#define BOOL_VAL(b)    ((b) ? TRUE_VAL : FALSE_VAL)
+#define STRING_VAL(s)  (QNAN | TAG_STRING | (uint64_t)(uintptr_t)(s))
+#define BUILDER_VAL(b) (QNAN | TAG_BUILDER | (uint64_t)(uintptr_t)(b))
+
+static inline double value_to_double(Value value) {
+    double number;
+    memcpy(&number, &value, sizeof(number));
+    return number;
+}
+
+// A NaN computed from a boxed operand keeps its payload and would read back
+// as that operand, so it is turned into a plain NaN of the same sign
+static inline Value double_to_value(double number) {
+    Value value;
+    memcpy(&value, &number, sizeof(value));
+    if ((value & QNAN) == QNAN) {
+        value = (value & ((uint64_t)1 << 63)) | (uint64_t)0x7ff8000000000000;
+    }
+    return value;
+}
+
+static inline ValueType value_type(Value value) {
+    if (IS_NUMBER(value)) return VAL_NUMBER;
+    if (IS_BUILDER(value)) return VAL_BUILDER;
+    if (IS_STRING(value)) return VAL_STRING;
+    return IS_UNDEFINED(value) ? VAL_UNDEFINED : VAL_BOOL;
+}
+
+#else
+
+typedef struct {
+    ValueType type;
+    union {
+        double number;
+        char *string;
+        int boolean;
+        StringBuilder *builder;
+    } value;
+} Value;
+
+#define IS_NUMBER(v)    ((v).type == VAL_NUMBER)
+#define IS_BOOL(v)      ((v).type == VAL_BOOL)
+#define IS_UNDEFINED(v) ((v).type == VAL_UNDEFINED)
+#define IS_BUILDER(v)   ((v).type == VAL_BUILDER)
+#define IS_STRING(v)    ((v).type == VAL_STRING || (v).type == VAL_BUILDER)
+
+#define AS_NUMBER(v)  ((v).value.number)
+#define AS_BOOL(v)    ((v).value.boolean)
+#define AS_CSTRING(v) ((v).value.string)
+#define AS_BUILDER(v) ((v).value.builder)
+
+#define UNDEFINED_VAL  ((Value){VAL_UNDEFINED, {.number = 0}})
+#define NUMBER_VAL(n)  ((Value){VAL_NUMBER, {.number = (n)}})
+#define BOOL_VAL(b)    ((Value){VAL_BOOL, {.boolean = (b) != 0}})
+#define TRUE_VAL       BOOL_VAL(1)
+#define FALSE_VAL      BOOL_VAL(0)
+#define STRING_VAL(s)  ((Value){VAL_STRING, {.string = (s)}})
+#define BUILDER_VAL(b) ((Value){VAL_BUILDER, {.builder = (b)}})
+
+#define value_type(v) ((v).type)
+
+#endif // CALC_NO_NAN_BOXING
+
+// Numeric view of an operand of arithmetic or an ordering: booleans count as
+// 0/1 in either representation. Operators the type pass proved numeric read
+// AS_NUMBER directly.
+static inline double value_as_number(Value value) {
+    if (IS_BOOL(value)) {
+        return AS_BOOL(value) ? 1 : 0;
+    }
+    return AS_NUMBER(value);
+}
+
+// Truth of a condition (while, and, or, not) whose operand may not be a
+// boolean: only true is true, so numbers and strings are false in either
+// representation. Under NaN-boxing this is the same test as AS_BOOL.
+static inline int value_as_bool(Value value) {
+    return IS_BOOL(value) && AS_BOOL(value);
+}
+
+// Ownership of values. VAL_STRING literals belong to the program's arena;
+// builders are reference counted, so every Value copy that is kept must be
+// retained and every owned Value that is dropped must be released.
+#define value_retain(v) \
+    do { if (IS_BUILDER(v)) string_builder_retain(AS_BUILDER(v)); } while (0)
+#define value_release(v) \
+    do { if (IS_BUILDER(v)) string_builder_release(AS_BUILDER(v)); } while (0)
+
+// Helpers shared by the tree walker, the bytecode VM and the runtime of
+// compiled programs
+void print_value(Io *io, const char *label, Value value);
+char* value_to_string(Value value);
+const char* value_chars(Value value, size_t *length, char *scratch); // scratch: NUMBER_BUFFER_SIZE bytes
+Value concatenate_values(Value left, Value right); // Borrows both, returns an owned value
+int values_equal(Value left, Value right);
+int strings_equal(Value left, Value right); // Compares the text of any two values
+Value read_input(Io *io, Value prompt); // Borrows the prompt, returns an owned string
+
+#endif // VALUE_H
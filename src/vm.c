@@ -0,0 +1,233 @@
+#include "vm.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define READ_OPERAND() \
+    (ip += 4, (uint32_t)ip[-4] | ((uint32_t)ip[-3] << 8) | \
+              ((uint32_t)ip[-2] << 16) | ((uint32_t)ip[-1] << 24))
+
+// Run a compiled chunk. Globals live in a flat array indexed by the slot
+// numbers the resolver assigned, so variable access never looks at names.
+// Every Value on the stack and in a global slot owns one reference.
+int run_chunk(Context *ctx, Chunk *chunk) {
+    Value *stack = malloc((chunk->max_stack + 1) * sizeof(Value));
+    if (!stack) {
+        fprintf(stderr, "Out of memory while running\n");
+        exit(1);
+    }
+    Value *globals = ctx->globals;
+    Io *io = ctx->io;
+
+    const uint8_t *ip = chunk->code;
+    Value *sp = stack; // Points one past the top of the stack
+    Value a, b;
+    uint32_t operand;
+
+    for (;;) {
+        TRACE(TRACE_EVAL, TRACE_DEBUG, "op %d at %zu, stack depth %zu",
+              *ip, (size_t)(ip - chunk->code), (size_t)(sp - stack));
+        switch ((OpCode)*ip++) {
+            case OP_CONST:
+                *sp++ = chunk->constants[READ_OPERAND()];
+                break;
+            case OP_TRUE:
+                *sp++ = TRUE_VAL;
+                break;
+            case OP_FALSE:
+                *sp++ = FALSE_VAL;
+                break;
+            case OP_GET_GLOBAL:
+                *sp = globals[READ_OPERAND()];
+                value_retain(*sp);
+                sp++;
+                break;
+            case OP_GET_GLOBAL_CHECKED:
+                operand = READ_OPERAND();
+                if (IS_UNDEFINED(globals[operand])) {
+                    context_fail(ctx, "Undefined variable: %s", chunk->globals[operand]);
+                    goto failed;
+                }
+                *sp = globals[operand];
+                value_retain(*sp);
+                sp++;
+                break;
+            case OP_SET_GLOBAL:
+                operand = READ_OPERAND();
+                value_release(globals[operand]);
+                globals[operand] = *--sp;
+                break;
+            case OP_ADD:
+                b = *--sp;
+                a = sp[-1];
+                if (IS_STRING(a) || IS_STRING(b)) {
+                    sp[-1] = concatenate_values(a, b);
+                    value_release(a);
+                    value_release(b);
+                } else {
+                    sp[-1] = NUMBER_VAL(value_as_number(a) + value_as_number(b));
+                }
+                break;
+            case OP_SUB:
+                b = *--sp;
+                value_release(b);
+                value_release(sp[-1]);
+                sp[-1] = NUMBER_VAL(value_as_number(sp[-1]) - value_as_number(b));
+                break;
+            case OP_MUL:
+                b = *--sp;
+                value_release(b);
+                value_release(sp[-1]);
+                sp[-1] = NUMBER_VAL(value_as_number(sp[-1]) * value_as_number(b));
+                break;
+            case OP_DIV:
+                b = *--sp;
+                value_release(b);
+                value_release(sp[-1]);
+                sp[-1] = NUMBER_VAL(value_as_number(sp[-1]) / value_as_number(b));
+                break;
+            case OP_NEG:
+                value_release(sp[-1]);
+                sp[-1] = NUMBER_VAL(-value_as_number(sp[-1]));
+                break;
+            case OP_NOT:
+                value_release(sp[-1]);
+                sp[-1] = BOOL_VAL(!value_as_bool(sp[-1]));
+                break;
+            case OP_EQ:
+                b = *--sp;
+                a = sp[-1];
+                sp[-1] = BOOL_VAL(values_equal(a, b));
+                value_release(a);
+                value_release(b);
+                break;
+            case OP_NEQ:
+                b = *--sp;
+                a = sp[-1];
+                sp[-1] = BOOL_VAL(!values_equal(a, b));
+                value_release(a);
+                value_release(b);
+                break;
+            case OP_LT:
+                b = *--sp;
+                value_release(b);
+                value_release(sp[-1]);
+                sp[-1] = BOOL_VAL(value_as_number(sp[-1]) < value_as_number(b));
+                break;
+            case OP_GT:
+                b = *--sp;
+                value_release(b);
+                value_release(sp[-1]);
+                sp[-1] = BOOL_VAL(value_as_number(sp[-1]) > value_as_number(b));
+                break;
+            case OP_LTE:
+                b = *--sp;
+                value_release(b);
+                value_release(sp[-1]);
+                sp[-1] = BOOL_VAL(value_as_number(sp[-1]) <= value_as_number(b));
+                break;
+            case OP_GTE:
+                b = *--sp;
+                value_release(b);
+                value_release(sp[-1]);
+                sp[-1] = BOOL_VAL(value_as_number(sp[-1]) >= value_as_number(b));
+                break;
+            case OP_ADD_NUMBERS:
+                b = *--sp;
+                sp[-1] = NUMBER_VAL(AS_NUMBER(sp[-1]) + AS_NUMBER(b));
+                break;
+            case OP_CONCAT:
+                b = *--sp;
+                a = sp[-1];
+                sp[-1] = concatenate_values(a, b);
+                value_release(a);
+                value_release(b);
+                break;
+            case OP_EQ_NUMBERS:
+                b = *--sp;
+                sp[-1] = BOOL_VAL(AS_NUMBER(sp[-1]) == AS_NUMBER(b));
+                break;
+            case OP_NEQ_NUMBERS:
+                b = *--sp;
+                sp[-1] = BOOL_VAL(AS_NUMBER(sp[-1]) != AS_NUMBER(b));
+                break;
+            case OP_EQ_STRINGS:
+                b = *--sp;
+                a = sp[-1];
+                sp[-1] = BOOL_VAL(strings_equal(a, b));
+                value_release(a);
+                value_release(b);
+                break;
+            case OP_NEQ_STRINGS:
+                b = *--sp;
+                a = sp[-1];
+                sp[-1] = BOOL_VAL(!strings_equal(a, b));
+                value_release(a);
+                value_release(b);
+                break;
+            case OP_INPUT:
+                a = sp[-1];
+                sp[-1] = read_input(io, a);
+                value_release(a);
+                break;
+            case OP_TO_BOOL:
+                value_release(sp[-1]);
+                sp[-1] = BOOL_VAL(value_as_bool(sp[-1]));
+                break;
+            case OP_JUMP:
+                operand = READ_OPERAND();
+                ip = chunk->code + operand;
+                break;
+            case OP_JUMP_IF_FALSE:
+                operand = READ_OPERAND();
+                value_release(sp[-1]);
+                if (!value_as_bool(*--sp)) {
+                    ip = chunk->code + operand;
+                }
+                break;
+            case OP_AND:
+                operand = READ_OPERAND();
+                value_release(sp[-1]);
+                if (!value_as_bool(sp[-1])) {
+                    sp[-1] = FALSE_VAL;
+                    ip = chunk->code + operand;
+                } else {
+                    sp--;
+                }
+                break;
+            case OP_OR:
+                operand = READ_OPERAND();
+                value_release(sp[-1]);
+                if (value_as_bool(sp[-1])) {
+                    sp[-1] = TRUE_VAL;
+                    ip = chunk->code + operand;
+                } else {
+                    sp--;
+                }
+                break;
+            case OP_PRINT:
+                print_value(io, "Print", *--sp);
+                value_release(*sp);
+                break;
+            case OP_RESULT:
+                print_value(io, "Result", *--sp);
+                value_release(*sp);
+                break;
+            case OP_HALT:
+                free(stack);
+                return 1;
+            default:
+                context_fail(ctx, "Unknown opcode: %d", ip[-1]);
+                goto failed;
+        }
+    }
+
+failed:
+    while (sp > stack) {
+        sp--;
+        value_release(*sp);
+    }
+    free(stack);
+    return 0;
+}
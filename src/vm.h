@@ -0,0 +1,12 @@
+#ifndef VM_H
+#define VM_H
+
+#include "compiler.h"
+#include "context.h"
+
+// Run a chunk on the context's globals, which context_bind() must have given
+// at least chunk->global_count slots. The variables keep their values after
+// the run. Returns 1, or 0 if the run failed (see ctx->error).
+int run_chunk(Context *ctx, Chunk *chunk);
+
+#endif // VM_H
@@ -0,0 +1,91 @@
+// Embedding API (calc.h): inputs keep the types and values the caller gives
+// them, whatever the program does with them
+#include <stdio.h>
+#include <string.h>
+#include "calc.h"
+
+static int failures = 0;
+
+static void check(int condition, const char *what) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static CalcProgram* compile_with_input(const char *source, const char *input) {
+    const char *inputs[] = {input};
+    CalcProgram *program = calc_compile(source, strlen(source), inputs, 1);
+    check(program != NULL, "program compiles");
+    return program;
+}
+
+static int output_is(CalcBindings *bindings, const char *expected) {
+    size_t length;
+    const char *output = calc_output(bindings, &length);
+    return length == strlen(expected) && memcmp(output, expected, length) == 0;
+}
+
+// The loop is skipped, so price still holds the caller's string: the type
+// pass must not take the number assigned in the loop for its only type
+static void test_input_type_not_inferred(void) {
+    const char *source =
+        "n = 5\n"
+        "while n < 3 {\n"
+        "    price = 5\n"
+        "    n = n + 1\n"
+        "}\n"
+        "total = price + 1\n"
+        "print total\n";
+    CalcProgram *program = compile_with_input(source, "price");
+    if (!program) return;
+    CalcBindings *bindings = calc_bindings_new(program);
+    check(calc_set_var(bindings, "price", calc_string_value("abc", 3)), "set price");
+    check(calc_run(bindings), "run with a string input");
+    check(output_is(bindings, "Print: abc1\n"), "string input concatenates");
+    CalcValue total;
+    check(calc_get_var(bindings, "total", &total), "get total");
+    check(total.type == CALC_STRING && total.length == 4 && memcmp(total.string, "abc1", 4) == 0,
+          "total is the string abc1");
+
+    check(calc_set_var(bindings, "price", calc_number_value(2)), "set price to a number");
+    check(calc_run(bindings), "run with a number input");
+    check(output_is(bindings, "Print: 3\n"), "number input adds");
+    calc_bindings_free(bindings);
+    calc_free(program);
+}
+
+// A program that assigns its input sees the value set, not the one the last
+// run left, every time it runs
+static void test_input_fresh_each_run(void) {
+    CalcProgram *program = compile_with_input("price = price * 2\nprint price\n", "price");
+    if (!program) return;
+    CalcBindings *bindings = calc_bindings_new(program);
+    check(calc_set_var(bindings, "price", calc_number_value(3)), "set price");
+    for (int run = 0; run < 3; run++) {
+        check(calc_run(bindings), "run");
+        check(output_is(bindings, "Print: 6\n"), "each run doubles the value set");
+    }
+    calc_bindings_free(bindings);
+    calc_free(program);
+}
+
+static void test_empty_string_input(void) {
+    CalcProgram *program = compile_with_input("label = name + \"!\"\n", "name");
+    if (!program) return;
+    CalcBindings *bindings = calc_bindings_new(program);
+    check(calc_set_var(bindings, "name", calc_string_value("", 0)), "set an empty name");
+    check(calc_run(bindings), "run with an empty string");
+    CalcValue name;
+    check(calc_get_var(bindings, "name", &name), "get name");
+    check(name.type == CALC_STRING && name.string != NULL && name.length == 0, "name is empty");
+    calc_bindings_free(bindings);
+    calc_free(program);
+}
+
+int main(void) {
+    test_input_type_not_inferred();
+    test_input_fresh_each_run();
+    test_empty_string_input();
+    return failures > 0;
+}